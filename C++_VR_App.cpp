@@ -21,26 +21,227 @@
 #include <unistd.h>     // For access() function to check file existence
 #include <sstream>      // String stream operations for string manipulation
 #include <map>          // Map container for key-value pairs
-#include <regex>        // Regular expressions for pattern matching
 #include <vector>       // Vector container for dynamic arrays
 #include <iomanip>      // Input/output manipulators for formatting
 #include <chrono>       // For timestamp generation
+#include <cstdio>       // Buffered C file I/O for report output
+#include <cstring>      // strlen() for section descriptor names
+#include <strings.h>    // strcasecmp() for Notion property names
+#include <thread>       // Worker threads for bulk processing
+#include <mutex>        // Synchronization for shared state
+#include <condition_variable> // Waiting for queued work
+#include <atomic>       // Lock-free counters
+#include <deque>        // Per-worker task queues
+#include <functional>   // Type-erased tasks
+#include <future>       // Overlapping Notion page creation with categorization
+#include <unordered_map> // Hash indexes
+#include <list>         // LRU ordering
+#include <set>          // Sorted unique keys
+#include <string_view>  // Zero-copy views into mapped files
+#include <cctype>       // Character classification for text normalization
+#include <cmath>        // Trigonometry for the FFT
+#include <cerrno>       // errno for interrupted reads
+#include <memory>       // Smart pointers
+#include <filesystem>   // Directory traversal for bulk processing
+#include <algorithm>    // std::max and friends
+#include <fcntl.h>      // open() for memory-mapped input
+#include <sys/mman.h>   // mmap() for memory-mapped input
+#include <sys/stat.h>   // fstat() for file sizes
+#include <sys/wait.h>   // waitpid() for the pdflatex process pool
+#include <sys/resource.h> // getrusage() for the batch memory summary
+#include <sys/syscall.h>  // close_range() for forked children
+#include <cstdint>      // Fixed-width integers
+#include <cstddef>      // std::max_align_t for the JSON arena
+#include <zlib.h>       // Block compression for the columnar archive
 
 // Include the nlohmann/json library for JSON parsing and manipulation
 #include "nlohmann/json.hpp"
 // Include the configuration file for API keys
 #include "config.h"
-using json = nlohmann::json;
+/**
+ * Per-job memory arena for JSON documents
+ * 
+ * Every JSON node, array buffer and map node of a job's documents (the categorized
+ * result, the Notion payloads, the schema update) would otherwise be a separate heap
+ * allocation. While a JobArenaScope is active on a thread, ArenaAllocator carves those
+ * allocations out of large chunks owned by the arena instead. Freeing individual nodes
+ * becomes a no-op and the whole graph is released in one shot when the arena is
+ * destroyed or reset.
+ * 
+ * Documents allocated from an arena must not outlive it (declare the arena first).
+ * They may be freed on any thread: each allocation carries a small header recording
+ * where it came from.
+ */
+class JobArena {
+public:
+    explicit JobArena(std::size_t chunkSize = 64 * 1024) : chunkSize_(chunkSize) {}
+
+    ~JobArena() {
+        for (auto &chunk : chunks_) {
+            std::free(chunk.memory);
+        }
+    }
+
+    JobArena(const JobArena&) = delete;
+    JobArena& operator=(const JobArena&) = delete;
+
+    void *allocate(std::size_t bytes, std::size_t alignment) {
+        while (current_ < chunks_.size()) {
+            Chunk &chunk = chunks_[current_];
+            std::size_t offset = (chunk.used + alignment - 1) & ~(alignment - 1);
+            if (offset + bytes <= chunk.size) {
+                chunk.used = offset + bytes;
+                bytesUsed_ += bytes;
+                return chunk.memory + offset;
+            }
+            ++current_;
+        }
+
+        // Chunks double in size so large jobs need only a few of them
+        std::size_t size = std::max(bytes + alignment, chunks_.empty() ? chunkSize_ : chunks_.back().size * 2);
+        char *memory = static_cast<char*>(std::malloc(size));
+        if (!memory) {
+            throw std::bad_alloc();
+        }
+        chunks_.push_back({memory, size, 0});
+        current_ = chunks_.size() - 1;
+        return allocate(bytes, alignment);
+    }
+
+    // Release everything allocated so far while keeping the chunks for reuse
+    void reset() {
+        for (auto &chunk : chunks_) {
+            chunk.used = 0;
+        }
+        current_ = 0;
+        bytesUsed_ = 0;
+    }
+
+    std::size_t bytesUsed() const {
+        return bytesUsed_;
+    }
+
+    // The arena that ArenaAllocator draws from on this thread, or nullptr
+    static JobArena *&current() {
+        thread_local JobArena *arena = nullptr;
+        return arena;
+    }
+
+private:
+    struct Chunk {
+        char *memory;
+        std::size_t size;
+        std::size_t used;
+    };
+
+    std::vector<Chunk> chunks_;
+    std::size_t current_ = 0;
+    std::size_t chunkSize_;
+    std::size_t bytesUsed_ = 0;
+};
+
+/**
+ * RAII guard making an arena the allocation source for JSON documents on this thread
+ */
+class JobArenaScope {
+public:
+    explicit JobArenaScope(JobArena &arena) : previous_(JobArena::current()) {
+        JobArena::current() = &arena;
+    }
+
+    // Allocate from the heap within the scope, for documents that outlive the job
+    explicit JobArenaScope(std::nullptr_t) : previous_(JobArena::current()) {
+        JobArena::current() = nullptr;
+    }
+
+    ~JobArenaScope() {
+        JobArena::current() = previous_;
+    }
+
+    JobArenaScope(const JobArenaScope&) = delete;
+    JobArenaScope& operator=(const JobArenaScope&) = delete;
+
+private:
+    JobArena *previous_;
+};
+
+/**
+ * Stateless allocator drawing from the thread's active JobArena
+ * 
+ * Falls back to the regular heap when no arena is active, so JSON values created
+ * outside a job behave exactly as with std::allocator.
+ */
+template <typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+
+    ArenaAllocator() noexcept = default;
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>&) noexcept {}
+
+    T *allocate(std::size_t count) {
+        static_assert(alignof(T) <= kHeaderSize, "ArenaAllocator header would misalign T");
+        std::size_t bytes = count * sizeof(T) + kHeaderSize;
+        JobArena *arena = JobArena::current();
+        char *block = arena ? static_cast<char*>(arena->allocate(bytes, kHeaderSize))
+                            : static_cast<char*>(::operator new(bytes));
+        *reinterpret_cast<std::uintptr_t*>(block) = arena ? kFromArena : kFromHeap;
+        return reinterpret_cast<T*>(block + kHeaderSize);
+    }
+
+    void deallocate(T *pointer, std::size_t) noexcept {
+        char *block = reinterpret_cast<char*>(pointer) - kHeaderSize;
+        // Arena memory is released with the arena itself
+        if (*reinterpret_cast<std::uintptr_t*>(block) == kFromHeap) {
+            ::operator delete(block);
+        }
+    }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>&) const noexcept { return true; }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>&) const noexcept { return false; }
+
+private:
+    static constexpr std::size_t kHeaderSize = alignof(std::max_align_t);
+    static constexpr std::uintptr_t kFromHeap = 0;
+    static constexpr std::uintptr_t kFromArena = 1;
+};
+
+// JSON document type used throughout the application; see JobArena
+using json = nlohmann::basic_json<std::map, std::vector, std::string, bool, std::int64_t, std::uint64_t,
+                                  double, ArenaAllocator>;
 using namespace std;
 
 /**
- * Global variables to store the property names from the Notion database
+ * Function to read an API base URL, allowing it to be overridden from the environment
  * 
- * These variables are used to map the fields from the GPT response
- * to the property names in the Notion database, which may have different names.
+ * Setting OPENAI_BASE_URL or NOTION_BASE_URL (e.g. to http://127.0.0.1:8089 for
+ * mock_api_server.js) redirects every request to that host.
+ * 
+ * @param variable Name of the environment variable
+ * @param defaultUrl URL used when the variable is not set
+ * @return The base URL without a trailing slash
  */
-string g_titlePropertyName = "";
-map<string, string> g_propertyNameMap;
+string getBaseUrl(const char *variable, const char *defaultUrl) {
+    const char *value = getenv(variable);
+    string url = (value && *value) ? value : defaultUrl;
+    while (!url.empty() && url.back() == '/') {
+        url.pop_back();
+    }
+    return url;
+}
+
+const string &openAiBaseUrl() {
+    static const string url = getBaseUrl("OPENAI_BASE_URL", "https://api.openai.com");
+    return url;
+}
+
+const string &notionBaseUrl() {
+    static const string url = getBaseUrl("NOTION_BASE_URL", "https://api.notion.com");
+    return url;
+}
 
 /**
  * Function to prompt the user to select an audio file
@@ -69,11 +270,180 @@ string getFileFromDialog() {
     return filePath;
 }
 
+/**
+ * Function to read a size limit in megabytes from the environment
+ * 
+ * @param variable Name of the environment variable
+ * @param defaultMegabytes Limit when the variable is unset
+ * @return The limit in bytes, 0 if the variable is "off"
+ */
+size_t megabytesFromEnvironment(const char *variable, size_t defaultMegabytes) {
+    const char *configured = getenv(variable);
+    if (!configured || !*configured) {
+        return defaultMegabytes << 20;
+    }
+    if (string(configured) == "off") {
+        return 0;
+    }
+    return static_cast<size_t>(strtod(configured, nullptr) * (1 << 20));
+}
+
+/**
+ * Upper bound on any API response; larger transfers are aborted (VR_MAX_RESPONSE_MB,
+ * default 256, "off" for no limit)
+ */
+size_t maxResponseBytes() {
+    static const size_t limit = megabytesFromEnvironment("VR_MAX_RESPONSE_MB", 256);
+    return limit;
+}
+
+/**
+ * Response body that spills to disk once it outgrows its memory allowance
+ * 
+ * The first VR_RESPONSE_MEMORY_MB (default 4) bytes are kept in memory; beyond that,
+ * the body is moved to an unlinked temporary file and read back through a memory
+ * mapping, so a huge response (e.g. word timings of a long recording) costs page
+ * cache rather than heap.
+ */
+class SpillBuffer {
+public:
+    SpillBuffer() : memoryLimit_(memoryAllowance()) {}
+
+    ~SpillBuffer() {
+        unmap();
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+    }
+
+    SpillBuffer(const SpillBuffer&) = delete;
+    SpillBuffer& operator=(const SpillBuffer&) = delete;
+
+    // Bytes kept in memory before the body is spilled (0 never spills)
+    static size_t memoryAllowance() {
+        static const size_t allowance = megabytesFromEnvironment("VR_RESPONSE_MEMORY_MB", 4);
+        return allowance;
+    }
+
+    /**
+     * Function to append received bytes
+     * 
+     * @return false if the spill file could not be written
+     */
+    bool append(const char *bytes, size_t count) {
+        unmap();
+        if (fd_ < 0 && (memoryLimit_ == 0 || memory_.size() + count <= memoryLimit_)) {
+            memory_.append(bytes, count);
+            size_ += count;
+            return true;
+        }
+        if (fd_ < 0 && !spill()) {
+            return false;
+        }
+        if (!writeAll(bytes, count)) {
+            return false;
+        }
+        size_ += count;
+        return true;
+    }
+
+    // Whole body as contiguous bytes, valid until the next append()
+    const char *data() {
+        if (fd_ < 0) {
+            return memory_.data();
+        }
+        if (!mapped_ && size_ > 0) {
+            void *mapping = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+            mapped_ = mapping == MAP_FAILED ? nullptr : static_cast<const char*>(mapping);
+        }
+        return mapped_ ? mapped_ : "";
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+    bool spilled() const {
+        return fd_ >= 0;
+    }
+
+    // Number of responses spilled to disk by this process
+    static size_t spillCount() {
+        return spillCount_.load(memory_order_relaxed);
+    }
+
+private:
+    bool spill() {
+        string path = (std::filesystem::temp_directory_path() / "vr_response_XXXXXX").string();
+        fd_ = mkstemp(&path[0]);
+        if (fd_ < 0) {
+            cerr << "Failed to create spill file for a large response" << endl;
+            return false;
+        }
+        unlink(path.c_str());
+        spillCount_.fetch_add(1, memory_order_relaxed);
+        bool written = writeAll(memory_.data(), memory_.size());
+        string().swap(memory_);
+        return written;
+    }
+
+    bool writeAll(const char *bytes, size_t count) {
+        while (count > 0) {
+            ssize_t written = write(fd_, bytes, count);
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+            if (written <= 0) {
+                cerr << "Failed to write spill file for a large response" << endl;
+                return false;
+            }
+            bytes += written;
+            count -= written;
+        }
+        return true;
+    }
+
+    void unmap() {
+        if (mapped_) {
+            munmap(const_cast<char*>(mapped_), size_);
+            mapped_ = nullptr;
+        }
+    }
+
+    size_t memoryLimit_;
+    string memory_;
+    size_t size_ = 0;
+    int fd_ = -1;
+    const char *mapped_ = nullptr;
+    static atomic<size_t> spillCount_;
+};
+
+atomic<size_t> SpillBuffer::spillCount_{0};
+
+/**
+ * Callback function for CURL to write received data into a SpillBuffer
+ * 
+ * @param contents Pointer to the received data
+ * @param size Size of each data element
+ * @param nmemb Number of data elements
+ * @param output The buffer receiving the data
+ * @return The total size of the data received, or 0 to abort the transfer
+ */
+size_t SpillWriteCallback(void *contents, size_t size, size_t nmemb, SpillBuffer *output) {
+    size_t totalSize = size * nmemb;
+    if (maxResponseBytes() > 0 && output->size() + totalSize > maxResponseBytes()) {
+        cerr << "Response exceeds " << maxResponseBytes() << " bytes (VR_MAX_RESPONSE_MB), aborting the transfer" << endl;
+        return 0;
+    }
+    return output->append(reinterpret_cast<char*>(contents), totalSize) ? totalSize : 0;
+}
+
 /**
  * Callback function for CURL to write received data
  * 
  * This function is called by CURL when data is received from an HTTP request.
- * It appends the received data to the output string.
+ * It appends the received data to the output string, and aborts the transfer
+ * (by returning 0) when the response would exceed maxResponseBytes().
  * 
  * @param contents Pointer to the received data
  * @param size Size of each data element
@@ -83,944 +453,7719 @@ string getFileFromDialog() {
  */
 size_t WriteCallback(void *contents, size_t size, size_t nmemb, string *output) {
     size_t totalSize = size * nmemb;
+    if (maxResponseBytes() > 0 && output->size() + totalSize > maxResponseBytes()) {
+        cerr << "Response exceeds " << maxResponseBytes() << " bytes (VR_MAX_RESPONSE_MB), aborting the transfer" << endl;
+        return 0;
+    }
     output->append(reinterpret_cast<char*>(contents), totalSize);
     return totalSize;
 }
 
 /**
- * Function to transcribe audio using the OpenAI Whisper API
+ * Function to compute the 64-bit FNV-1a hash of a block of bytes
  * 
- * This function sends an audio file to the OpenAI Whisper API for transcription.
- * It handles:
- * 1. Reading the audio file
- * 2. Setting up the API request with proper headers and parameters
- * 3. Sending the request to the API
- * 4. Receiving and returning the response
+ * @param data Pointer to the bytes to hash
+ * @param size Number of bytes
+ * @param seed Hash to continue from (defaults to the FNV offset basis)
+ * @return The hash value
+ */
+uint64_t fnv1aHash(const char *data, size_t size, uint64_t seed = 14695981039346656037ULL) {
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * Read-only memory mapping of a file
  * 
- * @param filePath Path to the audio file to transcribe
- * @param apiKey OpenAI API key for authentication
- * @return The API response containing the transcription
+ * Used by the bulk tools to parse stored JSON directly from the page cache
+ * without copying it into a std::string first.
  */
-string transcribeAudio(const string &filePath, const string &apiKey) {
-    CURL *curl;
-    CURLcode res;
-    string responseString;
-    curl_global_init(CURL_GLOBAL_DEFAULT);
-    curl = curl_easy_init();
-    if (curl) {
-        ifstream file(filePath, ios::binary);
-        if (!file.is_open()) {
-            cerr << "Failed to open file: " << filePath << endl;
-            exit(EXIT_FAILURE);
+class MappedFile {
+public:
+    explicit MappedFile(const string &path, int advice = MADV_SEQUENTIAL) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            close(fd);
+            return;
+        }
+        if (info.st_size > 0) {
+            void *mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped != MAP_FAILED) {
+                madvise(mapped, info.st_size, advice);
+                data_ = static_cast<const char*>(mapped);
+                size_ = info.st_size;
+            }
+        } else if (info.st_size == 0) {
+            empty_ = true;
         }
-        ostringstream oss;
-        oss << file.rdbuf();
-        string fileData = oss.str();
+        close(fd);
+    }
 
-        // Set up the header with the API key
-        struct curl_slist *headers = nullptr;
-        headers = curl_slist_append(headers, ("Authorization: Bearer " + apiKey).c_str());
+    ~MappedFile() {
+        if (data_) {
+            munmap(const_cast<char*>(data_), size_);
+        }
+    }
 
-        // Set the API endpoint for transcription
-        curl_easy_setopt(curl, CURLOPT_URL, "https://api.openai.com/v1/audio/transcriptions");
-        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-        curl_easy_setopt(curl, CURLOPT_POST, 1L);
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
 
-        // Set up MIME form for file upload and model parameter
-        curl_mime *form = curl_mime_init(curl);
+    bool isOpen() const { return data_ != nullptr || empty_; }
+    const char *data() const { return data_; }
+    size_t size() const { return size_; }
 
-        // Add the file field to the form
-        curl_mimepart *field = curl_mime_addpart(form);
-        curl_mime_name(field, "file");
-        curl_mime_filename(field, filePath.c_str());
-        curl_mime_data(field, fileData.c_str(), fileData.size());
+private:
+    const char *data_ = nullptr;
+    size_t size_ = 0;
+    bool empty_ = false;
+};
 
-        // Add the model parameter
-        field = curl_mime_addpart(form);
-        curl_mime_name(field, "model");
-        curl_mime_data(field, "whisper-1", CURL_ZERO_TERMINATED);
+/**
+ * Record-and-replay layer for HTTP exchanges
+ * 
+ * Every API request goes through performHttpRequest. When VR_HTTP_RECORD is set to a
+ * file path, each exchange (method, URL path, request body hash, status, response
+ * body and elapsed time) is appended to that file. When VR_HTTP_REPLAY is set, requests
+ * are answered from such a file instead of the network, so the CPU side of the
+ * pipeline can be benchmarked on identical workloads. VR_HTTP_REPLAY_TIMING selects
+ * whether replayed responses keep their recorded latency ("original", the default)
+ * or are returned immediately ("fast").
+ * 
+ * File layout (all integers little-endian):
+ *   "VRHTTP01"
+ *   records: u32 method length, method, u32 path length, path, u64 body hash,
+ *            i32 curl code, i32 HTTP status, u64 elapsed microseconds,
+ *            u64 response length, response bytes
+ *   index:   u64 record count, then per record u64 key hash and u64 record offset
+ *   trailer: u64 index offset, "VRHTIDX1"
+ * A file without a trailer (e.g. from an interrupted recording) is indexed by scanning it.
+ */
+class HttpFixtures {
+public:
+    enum class Mode { Off, Record, Replay };
 
-        // Attach the form and set callback for response
-        curl_easy_setopt(curl, CURLOPT_MIMEPOST, form);
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &responseString);
+    struct Exchange {
+        CURLcode code;
+        long status;
+        uint64_t elapsedMicros;
+        const char *response;
+        size_t responseLength;
+    };
 
-        // Perform the request
-        res = curl_easy_perform(curl);
-        if (res != CURLE_OK) {
-            cerr << "CURL error (transcription): " << curl_easy_strerror(res) << endl;
-        }
+    static HttpFixtures &instance() {
+        static HttpFixtures fixtures;
+        return fixtures;
+    }
 
-        // Clean up
-        curl_mime_free(form);
-        curl_slist_free_all(headers);
-        curl_easy_cleanup(curl);
+    Mode mode() const {
+        return mode_;
     }
-    curl_global_cleanup();
-    return responseString;
-}
 
-/**
- * Function to escape JSON special characters in a string
- * 
- * This function escapes special characters in a string to make it safe for inclusion in JSON.
- * It handles characters like quotes, backslashes, and control characters.
- * 
- * @param input The string to escape
- * @return The escaped string
- */
-string escapeJsonString(const string &input) {
-    ostringstream escaped;
-    for (char c : input) {
-        switch (c) {
-            case '"': escaped << "\\\""; break;
-            case '\\': escaped << "\\\\"; break;
-            case '\b': escaped << "\\b"; break;
-            case '\f': escaped << "\\f"; break;
-            case '\n': escaped << "\\n"; break;
-            case '\r': escaped << "\\r"; break;
-            case '\t': escaped << "\\t"; break;
-            default:
-                if ('\x00' <= c && c <= '\x1f') {
-                    escaped << "\\u" << hex << setw(4) << setfill('0') << (int)c;
-                } else {
-                    escaped << c;
-                }
-        }
+    bool replayWithOriginalTiming() const {
+        return originalTiming_;
     }
-    return escaped.str();
-}
 
-/**
- * Function to communicate with the OpenAI Chat Completions API for categorizing transcription
- * 
- * This function sends the transcription text to the OpenAI GPT-4o model for analysis.
- * It requests categorization into various sections based on the Notion Voice Notes structure.
- * 
- * @param transcription The transcription text to analyze
- * @param apiKey OpenAI API key for authentication
- * @return The API response containing the categorized content
- */
-string categorizeWithOpenAI(const string& transcription, const string& apiKey) {
-    CURL* curl;
-    CURLcode res;
-    string responseString;
-    curl_global_init(CURL_GLOBAL_DEFAULT);
-    curl = curl_easy_init();
-    if (curl) {
-        // Escape transcription text for JSON safety
-        string escapedTranscription = escapeJsonString(transcription);
-
-        // Define the summary options from the Notion Voice Notes configuration
-        vector<string> summaryOptions = {
-            "Summary",
-            "Main Points",
-            "Action Items",
-            "References",
-            "Follow-up Questions",
-            "Stories",
-            "Arguments",
-            "Sentiment"
-        };
+    void record(const string &method, const string &path, uint64_t bodyHash, CURLcode code,
+                long status, uint64_t elapsedMicros, string_view response) {
+        lock_guard<mutex> lock(mutex_);
+        if (!recordFile_) {
+            return;
+        }
+        uint64_t offset = recordOffset_;
+        string header;
+        appendInteger<uint32_t>(header, method.size());
+        header += method;
+        appendInteger<uint32_t>(header, path.size());
+        header += path;
+        appendInteger<uint64_t>(header, bodyHash);
+        appendInteger<int32_t>(header, code);
+        appendInteger<int32_t>(header, status);
+        appendInteger<uint64_t>(header, elapsedMicros);
+        appendInteger<uint64_t>(header, response.size());
+        fwrite(header.data(), 1, header.size(), recordFile_);
+        fwrite(response.data(), 1, response.size(), recordFile_);
+        recordOffset_ += header.size() + response.size();
+        recordIndex_.push_back({exchangeKey(method, path, bodyHash), offset});
+    }
 
-        // Build the summary options string
-        string summaryOptionsStr = "";
-        for (size_t i = 0; i < summaryOptions.size(); ++i) {
-            summaryOptionsStr += summaryOptions[i];
-            if (i < summaryOptions.size() - 1) {
-                summaryOptionsStr += ", ";
+    /**
+     * Function to find the recorded response for a request
+     * 
+     * Exchanges with the same method, path and body are replayed in recorded order.
+     * If the body differs from every recording, exchanges with the same method and
+     * path are used instead, so e.g. a changed prompt still gets a response.
+     * 
+     * @return true if a recording was found
+     */
+    bool lookup(const string &method, const string &path, uint64_t bodyHash, Exchange &exchange) {
+        lock_guard<mutex> lock(mutex_);
+        auto entry = replayIndex_.find(exchangeKey(method, path, bodyHash));
+        if (entry == replayIndex_.end()) {
+            entry = replayIndex_.find(exchangeKey(method, path, 0));
+            if (entry == replayIndex_.end()) {
+                return false;
             }
         }
+        ReplayQueue &queue = entry->second;
+        uint64_t offset = queue.offsets[queue.next % queue.offsets.size()];
+        ++queue.next;
+        return readRecord(offset, exchange, nullptr);
+    }
 
-        // Build the JSON payload using a raw string literal for clarity
-        string data = R"({
-            "model": "gpt-4o",
-            "messages": [
-                {
-                    "role": "system",
-                    "content": "You are an assistant that analyzes voice recordings and outputs categorized sections in JSON format for Notion database integration."
-                },
-                {
-                    "role": "user",
-                    "content": "Analyze the following transcription and categorize it into these sections: )" + summaryOptionsStr + R"(. Generate an AI title for the note. For Type, suggest a category like 'AI Transcription', 'Meeting Notes', etc. For Duration, provide a time format like '00:07:26'. Calculate the Duration (Seconds) as a number. Include an AI Cost estimate (a small dollar amount). Also include an Icon field with the value '🤖'. Format all lists as arrays. Provide the output in clean JSON format with no markdown formatting.\n\nTranscription: )" + escapedTranscription + R"("
-                }
-            ]
-        })";
+private:
+    struct IndexEntry {
+        uint64_t key;
+        uint64_t offset;
+    };
 
-        // Set up the headers
-        struct curl_slist* headers = nullptr;
-        headers = curl_slist_append(headers, ("Authorization: Bearer " + apiKey).c_str());
-        headers = curl_slist_append(headers, "Content-Type: application/json");
+    struct ReplayQueue {
+        vector<uint64_t> offsets;
+        size_t next = 0;
+    };
 
-        // Set the API endpoint for chat completions
-        curl_easy_setopt(curl, CURLOPT_URL, "https://api.openai.com/v1/chat/completions");
-        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-        curl_easy_setopt(curl, CURLOPT_POST, 1L);
-        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, data.c_str());
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &responseString);
+    static constexpr char kMagic[] = "VRHTTP01";
+    static constexpr char kIndexMagic[] = "VRHTIDX1";
+    static constexpr size_t kMagicLength = 8;
 
-        // Perform the request
-        res = curl_easy_perform(curl);
-        if (res != CURLE_OK) {
-            cerr << "CURL error (chat completions): " << curl_easy_strerror(res) << endl;
+    HttpFixtures() {
+        const char *recordPath = getenv("VR_HTTP_RECORD");
+        const char *replayPath = getenv("VR_HTTP_REPLAY");
+        const char *timing = getenv("VR_HTTP_REPLAY_TIMING");
+        originalTiming_ = !(timing && string(timing) == "fast");
+
+        if (replayPath && *replayPath) {
+            if (loadReplayFile(replayPath)) {
+                mode_ = Mode::Replay;
+                cout << "Replaying HTTP exchanges from " << replayPath << endl;
+            } else {
+                cerr << "Failed to load HTTP replay file: " << replayPath << endl;
+                exit(EXIT_FAILURE);
+            }
+        } else if (recordPath && *recordPath) {
+            recordFile_ = fopen(recordPath, "wb");
+            if (!recordFile_) {
+                cerr << "Failed to open HTTP record file: " << recordPath << endl;
+                exit(EXIT_FAILURE);
+            }
+            fwrite(kMagic, 1, kMagicLength, recordFile_);
+            recordOffset_ = kMagicLength;
+            mode_ = Mode::Record;
+            cout << "Recording HTTP exchanges to " << recordPath << endl;
         }
+    }
 
-        // Clean up
-        curl_slist_free_all(headers);
-        curl_easy_cleanup(curl);
+    ~HttpFixtures() {
+        if (recordFile_) {
+            // Append the index so replays can load the file without scanning it
+            string index;
+            appendInteger<uint64_t>(index, recordIndex_.size());
+            for (const auto &entry : recordIndex_) {
+                appendInteger<uint64_t>(index, entry.key);
+                appendInteger<uint64_t>(index, entry.offset);
+            }
+            appendInteger<uint64_t>(index, recordOffset_);
+            index.append(kIndexMagic, kMagicLength);
+            fwrite(index.data(), 1, index.size(), recordFile_);
+            fclose(recordFile_);
+        }
     }
-    curl_global_cleanup();
-    return responseString;
-}
 
-/**
- * Function to ensure the Notion database has the required properties
- * 
- * This function:
- * 1. Retrieves the current structure of the Notion database
- * 2. Identifies the title property
- * 3. Checks for missing properties or properties with incorrect types
- * 4. Adds any missing properties with the correct types
- * 
- * Required properties include:
- * - Title property (for Summary)
- * - Type (select)
- * - Duration (rich_text)
- * - At Cost (number)
- * - Duration (Seconds) (number)
- * - Date (date)
- * - Main Points, Action Items, etc. (rich_text)
- * 
- * @param notionDatabaseId ID of the Notion database
- * @param notionApiKey Notion API key for authentication
- * @return true if the database has all required properties, false otherwise
- */
-bool ensureNotionDatabaseProperties(const string &notionDatabaseId,const string &notionApiKey) {
-    // Get the current database structure
-    CURL *curl;
-    CURLcode res;
-    string responseString;
-    
-    curl_global_init(CURL_GLOBAL_DEFAULT);
-    curl = curl_easy_init();
-    if (!curl) {
-        cerr << "Failed to initialize CURL for database retrieval" << endl;
-        return false;
+    template <typename T>
+    static void appendInteger(string &out, T value) {
+        for (size_t i = 0; i < sizeof(T); ++i) {
+            out.push_back(static_cast<char>((static_cast<uint64_t>(value) >> (8 * i)) & 0xff));
+        }
     }
-    
-    // Set up the required headers
-    struct curl_slist *headers = nullptr;
-    headers = curl_slist_append(headers, ("Authorization: Bearer " + notionApiKey).c_str());
-    headers = curl_slist_append(headers, "Content-Type: application/json");
-    headers = curl_slist_append(headers, "Notion-Version: 2022-06-28");
-    
-    // Set the Notion API endpoint for retrieving the database
-    string url = "https://api.notion.com/v1/databases/" + notionDatabaseId;
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &responseString);
-    
-    // Perform the request
-    res = curl_easy_perform(curl);
-    if (res != CURLE_OK) {
-        cerr << "CURL error (database retrieval): " << curl_easy_strerror(res) << endl;
-        curl_slist_free_all(headers);
-        curl_easy_cleanup(curl);
-        curl_global_cleanup();
-        return false;
+
+    template <typename T>
+    bool readInteger(uint64_t &offset, T &value) const {
+        if (offset + sizeof(T) > replayFile_->size()) {
+            return false;
+        }
+        uint64_t result = 0;
+        for (size_t i = 0; i < sizeof(T); ++i) {
+            result |= static_cast<uint64_t>(static_cast<unsigned char>(replayFile_->data()[offset + i])) << (8 * i);
+        }
+        value = static_cast<T>(result);
+        offset += sizeof(T);
+        return true;
     }
-    
-    // Parse the response to check existing properties
-    try {
-        auto dbJson = json::parse(responseString);
-        
-        // Check if there was an error
-        if (dbJson.contains("object") && dbJson["object"] == "error") {
-            cerr << "Notion API error (database retrieval): " << dbJson["message"].get<string>() << endl;
-            cout << "Notion API response:" << endl << responseString << endl;
-            curl_slist_free_all(headers);
-            curl_easy_cleanup(curl);
-            curl_global_cleanup();
+
+    // Hash of method, path and body hash; a body hash of 0 keys the method and path alone
+    static uint64_t exchangeKey(const string &method, const string &path, uint64_t bodyHash) {
+        uint64_t hash = fnv1aHash(method.data(), method.size());
+        hash = fnv1aHash(" ", 1, hash);
+        hash = fnv1aHash(path.data(), path.size(), hash);
+        return fnv1aHash(reinterpret_cast<const char*>(&bodyHash), sizeof(bodyHash), hash);
+    }
+
+    // Decode the record at offset; optionally returns its method/path key pair
+    bool readRecord(uint64_t offset, Exchange &exchange, pair<uint64_t, uint64_t> *keys) const {
+        uint32_t methodLength, pathLength;
+        uint64_t bodyHash, responseLength;
+        int32_t code, status;
+        if (!readInteger(offset, methodLength) || offset + methodLength > replayFile_->size()) {
             return false;
         }
-        
-        // Get existing properties
-        map<string, string> existingProps;
-        if (dbJson.contains("properties") && dbJson["properties"].is_object()) {
-            for (auto& [key, value] : dbJson["properties"].items()) {
-                if (value.contains("type")) {
-                    existingProps[key] = value["type"];
-                }
-            }
+        string method(replayFile_->data() + offset, methodLength);
+        offset += methodLength;
+        if (!readInteger(offset, pathLength) || offset + pathLength > replayFile_->size()) {
+            return false;
         }
-        
-        // Find the existing title property
-        string titlePropName = "";
-        for (auto& [key, value] : existingProps) {
-            if (value == "title") {
-                titlePropName = key;
-                break;
-            }
+        string path(replayFile_->data() + offset, pathLength);
+        offset += pathLength;
+        if (!readInteger(offset, bodyHash) || !readInteger(offset, code) || !readInteger(offset, status)
+            || !readInteger(offset, exchange.elapsedMicros) || !readInteger(offset, responseLength)
+            || offset + responseLength > replayFile_->size()) {
+            return false;
         }
-        
-        if (titlePropName.empty()) {
-            cerr << "No title property found in the database" << endl;
-            curl_slist_free_all(headers);
-            curl_easy_cleanup(curl);
-            curl_global_cleanup();
+        exchange.code = static_cast<CURLcode>(code);
+        exchange.status = status;
+        exchange.response = replayFile_->data() + offset;
+        exchange.responseLength = responseLength;
+        if (keys) {
+            *keys = {exchangeKey(method, path, bodyHash), exchangeKey(method, path, 0)};
+        }
+        return true;
+    }
+
+    bool loadReplayFile(const string &path) {
+        replayFile_ = make_unique<MappedFile>(path);
+        if (!replayFile_->isOpen() || replayFile_->size() < kMagicLength
+            || memcmp(replayFile_->data(), kMagic, kMagicLength) != 0) {
             return false;
         }
-        
-        cout << "Found title property: " << titlePropName << endl;
-        
-        // Store the title property name for later use
-        g_titlePropertyName = titlePropName;
-        
-        // Define required properties with their types based on Notion Voice Notes configuration
-        map<string, string> requiredProps = {
-            {"Main Points", "rich_text"},
-            {"Action Items", "rich_text"},
-            {"Follow-up Questions", "rich_text"},
-            {"Stories", "rich_text"},
-            {"References", "rich_text"},
-            {"Arguments", "rich_text"},
-            {"Sentiment", "rich_text"},
-            {"Type", "select"},
-            {"Duration", "rich_text"},
-            {"AI Cost", "number"},
-            {"Duration (Seconds)", "number"},
-            {"Date", "date"},
-            {"Icon", "rich_text"}
-        };
-        
-        // Check which properties are missing or have the wrong type
-        vector<pair<string, string>> missingProps;
-        for (const auto& [propName, propType] : requiredProps) {
-            if (existingProps.find(propName) == existingProps.end()) {
-                missingProps.push_back({propName, propType});
-            } else if (existingProps[propName] != propType) {
-                cerr << "Warning: Property '" << propName << "' exists but has type '" 
-                     << existingProps[propName] << "' instead of '" << propType << "'" << endl;
+
+        // Collect record offsets from the index, or by scanning if there is none
+        vector<uint64_t> offsets;
+        uint64_t end = replayFile_->size();
+        uint64_t indexOffset = 0;
+        uint64_t trailer = end >= 16 ? end - 16 : 0;
+        if (trailer >= kMagicLength && memcmp(replayFile_->data() + end - kMagicLength, kIndexMagic, kMagicLength) == 0
+            && readInteger(trailer, indexOffset) && indexOffset < end) {
+            uint64_t count;
+            uint64_t position = indexOffset;
+            readInteger(position, count);
+            for (uint64_t i = 0; i < count; ++i) {
+                uint64_t key, offset;
+                if (!readInteger(position, key) || !readInteger(position, offset)) {
+                    return false;
+                }
+                offsets.push_back(offset);
+            }
+        } else {
+            uint64_t offset = kMagicLength;
+            Exchange exchange;
+            while (offset < end && readRecord(offset, exchange, nullptr)) {
+                offsets.push_back(offset);
+                offset = (exchange.response - replayFile_->data()) + exchange.responseLength;
             }
         }
-        
-        // If no properties are missing, return success
-        if (missingProps.empty()) {
-            cout << "All required properties exist in the database" << endl;
-            curl_slist_free_all(headers);
-            curl_easy_cleanup(curl);
-            curl_global_cleanup();
-            return true;
-        }
-        
-        // Build the update payload
-        json updatePayload;
-        json properties;
-        
-        for (const auto& [propName, propType] : missingProps) {
-            if (propType == "rich_text") {
-                properties[propName] = {{"type", "rich_text"}, {"rich_text", json::object()}};
-            } else if (propType == "select") {
-                properties[propName] = {{"type", "select"}, {"select", json::object()}};
-            } else if (propType == "number") {
-                properties[propName] = {{"type", "number"}, {"number", json::object()}};
-            } else if (propType == "date") {
-                properties[propName] = {{"type", "date"}, {"date", json::object()}};
+
+        for (uint64_t offset : offsets) {
+            Exchange exchange;
+            pair<uint64_t, uint64_t> keys;
+            if (!readRecord(offset, exchange, &keys)) {
+                return false;
             }
+            replayIndex_[keys.first].offsets.push_back(offset);
+            replayIndex_[keys.second].offsets.push_back(offset);
         }
-        
-        updatePayload["properties"] = properties;
-        string updatePayloadStr = updatePayload.dump();
-        
-        // Reset CURL for the update request
-        curl_easy_reset(curl);
-        
-        // Set up the PATCH request
-        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-        curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "PATCH");
-        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, updatePayloadStr.c_str());
-        
-        // Clear the response string
-        responseString.clear();
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &responseString);
-        
-        // Perform the update request
-        res = curl_easy_perform(curl);
-        if (res != CURLE_OK) {
-            cerr << "CURL error (database update): " << curl_easy_strerror(res) << endl;
-            curl_slist_free_all(headers);
-            curl_easy_cleanup(curl);
-            curl_global_cleanup();
-            return false;
+        return true;
+    }
+
+    Mode mode_ = Mode::Off;
+    bool originalTiming_ = true;
+    std::mutex mutex_;
+    FILE *recordFile_ = nullptr;
+    uint64_t recordOffset_ = 0;
+    vector<IndexEntry> recordIndex_;
+    unique_ptr<MappedFile> replayFile_;
+    unordered_map<uint64_t, ReplayQueue> replayIndex_;
+};
+
+/**
+ * Timeouts applied to every API request, and the deadline of the job it belongs to
+ * 
+ * Every request gets:
+ * - a connect timeout, covering the TLS handshake (VR_CONNECT_TIMEOUT_MS, default 10000)
+ * - a total timeout (VR_REQUEST_TIMEOUT_MS, default 300000), shortened to the time
+ *   left before the job's deadline
+ * - a stall limit: a transfer averaging below VR_LOW_SPEED_BYTES per second (default 1)
+ *   for VR_LOW_SPEED_SECONDS (default 120) is aborted
+ * 
+ * A job's deadline is VR_JOB_DEADLINE_S seconds (default 900, "off" for none) after
+ * it starts. It is held per thread, like the job arena: DeadlineScope installs it
+ * on the threads working for the job, and performHttpRequest refuses to start a
+ * request once it has passed. The budget covers the job's own work, not its turn:
+ * time spent queued at a StageScheduler postpones the deadline by as much.
+ */
+class RequestTimeouts {
+public:
+    using Clock = chrono::steady_clock;
+
+    static RequestTimeouts &instance() {
+        static RequestTimeouts timeouts;
+        return timeouts;
+    }
+
+    // Deadline of the job the calling thread works for (time_point::max() if none)
+    static Clock::time_point &currentDeadline() {
+        thread_local Clock::time_point deadline = Clock::time_point::max();
+        return deadline;
+    }
+
+    // Deadline of a job starting now
+    Clock::time_point jobDeadline() const {
+        return jobMs_ > 0 ? Clock::now() + chrono::milliseconds(jobMs_) : Clock::time_point::max();
+    }
+
+    // Moves the deadline of the calling thread's job back by time not spent on the job
+    static void postponeCurrentDeadline(Clock::duration delay) {
+        Clock::time_point &deadline = currentDeadline();
+        if (deadline != Clock::time_point::max()) {
+            deadline += delay;
         }
-        
-        // Check the update response
-        try {
-            auto updateJson = json::parse(responseString);
-            if (updateJson.contains("object") && updateJson["object"] == "error") {
-                cerr << "Notion API error (database update): " << updateJson["message"].get<string>() << endl;
-                cout << "Notion API response:" << endl << responseString << endl;
-                curl_slist_free_all(headers);
-                curl_easy_cleanup(curl);
-                curl_global_cleanup();
+    }
+
+    /**
+     * Function to set the timeouts of a request on a prepared CURL handle
+     * 
+     * @param curl The handle
+     * @return false if the job's deadline has already passed
+     */
+    bool apply(CURL *curl) const {
+        long timeoutMs = requestMs_;
+        Clock::time_point deadline = currentDeadline();
+        if (deadline != Clock::time_point::max()) {
+            long remainingMs = chrono::duration_cast<chrono::milliseconds>(deadline - Clock::now()).count();
+            if (remainingMs <= 0) {
                 return false;
             }
-            
-            cout << "Database properties updated successfully" << endl;
-        } catch (const exception& e) {
-            cerr << "Error parsing database update response: " << e.what() << endl;
-            cout << "Raw response:" << endl << responseString << endl;
-            curl_slist_free_all(headers);
-            curl_easy_cleanup(curl);
-            curl_global_cleanup();
-            return false;
+            timeoutMs = timeoutMs > 0 ? min(timeoutMs, remainingMs) : remainingMs;
         }
-        
-    } catch (const exception& e) {
-        cerr << "Error parsing database response: " << e.what() << endl;
-        cout << "Raw response:" << endl << responseString << endl;
-        curl_slist_free_all(headers);
-        curl_easy_cleanup(curl);
-        curl_global_cleanup();
-        return false;
+        curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, timeoutMs > 0 ? min(connectMs_, timeoutMs) : connectMs_);
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, timeoutMs);
+        curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, lowSpeedBytes_);
+        curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, lowSpeedSeconds_);
+        // Timeouts must not raise signals in multi-threaded use
+        curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+        return true;
     }
-    
-    // Clean up
-    curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
-    curl_global_cleanup();
-    
-    return true;
-}
+
+private:
+    RequestTimeouts()
+        : connectMs_(setting("VR_CONNECT_TIMEOUT_MS", 10000)),
+          requestMs_(setting("VR_REQUEST_TIMEOUT_MS", 300000)),
+          lowSpeedBytes_(setting("VR_LOW_SPEED_BYTES", 1)),
+          lowSpeedSeconds_(setting("VR_LOW_SPEED_SECONDS", 120)),
+          jobMs_(setting("VR_JOB_DEADLINE_S", 900) * 1000) {}
+
+    // A numeric setting; "off" (or 0) disables the limit
+    static long setting(const char *variable, long defaultValue) {
+        const char *configured = getenv(variable);
+        if (!configured || !*configured) {
+            return defaultValue;
+        }
+        return string(configured) == "off" ? 0 : strtol(configured, nullptr, 10);
+    }
+
+    long connectMs_;
+    long requestMs_;
+    long lowSpeedBytes_;
+    long lowSpeedSeconds_;
+    long jobMs_;
+};
 
 /**
- * Function to send a parsed JSON object into a Notion database
+ * Scope in which the current thread works for a job with the given deadline
+ */
+class DeadlineScope {
+public:
+    explicit DeadlineScope(RequestTimeouts::Clock::time_point deadline)
+        : previous_(RequestTimeouts::currentDeadline()) {
+        RequestTimeouts::currentDeadline() = deadline;
+    }
+
+    ~DeadlineScope() {
+        RequestTimeouts::currentDeadline() = previous_;
+    }
+
+    DeadlineScope(const DeadlineScope&) = delete;
+    DeadlineScope& operator=(const DeadlineScope&) = delete;
+
+private:
+    RequestTimeouts::Clock::time_point previous_;
+};
+
+/**
+ * Connection, TLS session and DNS caches shared by every request
  * 
- * This function:
- * 1. Ensures the database has the required properties
- * 2. Builds a JSON payload according to Notion's API requirements
- * 3. Handles different property types (title, select, number, date, rich_text)
- * 4. Converts arrays to comma-separated strings without square brackets
- * 5. Sends the data to the Notion API
+ * Each request uses its own CURL handle, which would otherwise open (and close) its
+ * own connection, paying the TCP and TLS handshakes every time. With the caches in a
+ * CURLSH, a handle picks up a live connection left by an earlier request, or at least
+ * resumes its TLS session. warmUpConnections() relies on this to open connections
+ * before the first real request needs them.
  * 
- * @param data The JSON data to send to Notion
- * @param notionDatabaseId ID of the Notion database
- * @param notionApiKey Notion API key for authentication
- * @return true if the data was successfully sent, false otherwise
+ * The caches live until the process exits (after curl_global_cleanup, when they can
+ * no longer be cleaned up safely).
  */
-bool sendToNotion(const nlohmann::json &data,const string &notionDatabaseId,const string &notionApiKey) {
-    // First, ensure the database has the required properties
-    if (!ensureNotionDatabaseProperties(notionDatabaseId, notionApiKey)) {
-        cerr << "Failed to ensure database properties" << endl;
-        return false;
+class SharedConnections {
+public:
+    static SharedConnections &instance() {
+        static SharedConnections connections;
+        return connections;
     }
-    // Build the JSON payload according to Notion's API requirements.
-    // The payload includes:
-    //   - A "parent" key specifying the database_id.
-    //   - A "properties" key that maps each key from your parsed JSON
-    //     into a Notion property.
-    nlohmann::json payload;
-    payload["parent"] = {{"database_id", notionDatabaseId}};
-    
-    nlohmann::json properties;
-    // Iterate over the key/value pairs in the input JSON.
-    for (auto& [key, value] : data.items()) {
-        // Handle each property based on its expected type in Notion
-        if (key == "AI_Title" || key == "Title") {
-            // Use the title property name from the database
-            string content = value.is_string() ? value.get<string>() : value.dump();
-            properties[g_titlePropertyName] = {
-                {"title", nlohmann::json::array({
-                    {{"text", {{"content", content}}}}
-                })}
-            };
-        } else if (key == "Summary") {
-            // Use the title property name from the database if AI_Title is not present
-            if (!data.contains("AI_Title") && !data.contains("Title")) {
-                string content = value.is_string() ? value.get<string>() : value.dump();
-                properties[g_titlePropertyName] = {
-                    {"title", nlohmann::json::array({
+
+    // Function to make a handle use the shared caches
+    void attach(CURL *curl) {
+        if (share_) {
+            curl_easy_setopt(curl, CURLOPT_SHARE, share_);
+        }
+    }
+
+    SharedConnections(const SharedConnections&) = delete;
+    SharedConnections& operator=(const SharedConnections&) = delete;
+
+private:
+    SharedConnections() : share_(curl_share_init()) {
+        if (!share_) {
+            return;
+        }
+        curl_share_setopt(share_, CURLSHOPT_LOCKFUNC, lock);
+        curl_share_setopt(share_, CURLSHOPT_UNLOCKFUNC, unlock);
+        curl_share_setopt(share_, CURLSHOPT_USERDATA, this);
+        curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+        curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+    }
+
+    static void lock(CURL *, curl_lock_data data, curl_lock_access, void *connections) {
+        static_cast<SharedConnections*>(connections)->mutexes_[data % kLockCount].lock();
+    }
+
+    static void unlock(CURL *, curl_lock_data data, void *connections) {
+        static_cast<SharedConnections*>(connections)->mutexes_[data % kLockCount].unlock();
+    }
+
+    static const size_t kLockCount = CURL_LOCK_DATA_LAST;
+
+    CURLSH *share_;
+    std::mutex mutexes_[kLockCount];
+};
+
+/**
+ * Per-host circuit breakers in front of the API hosts
+ * 
+ * After VR_BREAKER_FAILURES consecutive failed requests to a host (default 5, "off"
+ * to disable), its breaker opens: requests to the host are refused at once for
+ * VR_BREAKER_COOLDOWN_S seconds (default 30), instead of each one waiting out its
+ * connection attempts. After the cooldown, a single probe request is let through
+ * (half-open); if it succeeds the breaker closes and traffic resumes in full,
+ * otherwise it opens for another cooldown. A request fails if it could not be
+ * completed or the host answered with a 5xx status.
+ * 
+ * A refused request marks the calling thread (refusedOnThisThread), so that the job
+ * can be parked (see ParkedJobQueue) rather than stored with missing results.
+ */
+class CircuitBreakers {
+public:
+    using Clock = chrono::steady_clock;
+
+    struct HostStats {
+        string host;
+        size_t opened;
+        size_t refused;
+    };
+
+    static CircuitBreakers &instance() {
+        static CircuitBreakers breakers;
+        return breakers;
+    }
+
+    // Whether a request of the calling thread was refused since it was last reset
+    static bool &refusedOnThisThread() {
+        thread_local bool refused = false;
+        return refused;
+    }
+
+    // Scheme, host and port of a URL
+    static string hostOf(const string &url) {
+        size_t hostStart = url.find("://");
+        return url.substr(0, url.find('/', hostStart == string::npos ? 0 : hostStart + 3));
+    }
+
+    static bool isFailure(CURLcode res, long status) {
+        // An oversized response aborted by the write callback says nothing about the host
+        return (res != CURLE_OK && res != CURLE_WRITE_ERROR) || status >= 500;
+    }
+
+    /**
+     * Function to ask whether a request may be sent to the host of a URL
+     *
+     * Every allowed request must be followed by recordOutcome().
+     *
+     * @param url The request URL
+     * @return false if the host's breaker is open, or half-open with its probe in flight
+     */
+    bool allow(const string &url) {
+        if (threshold_ == 0) {
+            return true;
+        }
+        lock_guard<mutex> lock(mutex_);
+        Breaker &breaker = hosts_[hostOf(url)];
+        if (breaker.state == State::Open && Clock::now() >= breaker.openUntil) {
+            breaker.state = State::HalfOpen;
+            cout << "Probing " << hostOf(url) << " after " << cooldown_.count() << "s" << endl;
+            return true;
+        }
+        if (breaker.state != State::Closed) {
+            ++breaker.refused;
+            refusedOnThisThread() = true;
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * Function to record the outcome of an allowed request
+     *
+     * @param url The request URL
+     * @param failed true if the request failed (see isFailure)
+     */
+    void recordOutcome(const string &url, bool failed) {
+        if (threshold_ == 0) {
+            return;
+        }
+        lock_guard<mutex> lock(mutex_);
+        string host = hostOf(url);
+        Breaker &breaker = hosts_[host];
+        if (!failed) {
+            if (breaker.state != State::Closed) {
+                cout << "Circuit to " << host << " closed, resuming requests" << endl;
+            }
+            breaker.state = State::Closed;
+            breaker.consecutiveFailures = 0;
+            return;
+        }
+        ++breaker.consecutiveFailures;
+        // A failed probe reopens the breaker; late failures of requests sent before it opened do not extend it
+        if (breaker.state == State::HalfOpen) {
+            breaker.state = State::Open;
+            breaker.openUntil = Clock::now() + cooldown_;
+            cerr << "Probe of " << host << " failed, refusing requests for another " << cooldown_.count() << "s" << endl;
+        } else if (breaker.state == State::Closed && breaker.consecutiveFailures >= threshold_) {
+            breaker.state = State::Open;
+            breaker.openUntil = Clock::now() + cooldown_;
+            ++breaker.opened;
+            cerr << "Circuit to " << host << " opened after " << breaker.consecutiveFailures
+                 << " consecutive failures, refusing requests for " << cooldown_.count() << "s" << endl;
+        }
+    }
+
+    /**
+     * Function to check whether requests to the host of a URL are being refused
+     *
+     * @return true if the breaker is open and its cooldown has not ended
+     */
+    bool isOpen(const string &url) const {
+        lock_guard<mutex> lock(mutex_);
+        auto found = hosts_.find(hostOf(url));
+        return found != hosts_.end() && found->second.state == State::Open && Clock::now() < found->second.openUntil;
+    }
+
+    vector<HostStats> stats() const {
+        lock_guard<mutex> lock(mutex_);
+        vector<HostStats> result;
+        for (const auto &[host, breaker] : hosts_) {
+            if (breaker.opened > 0 || breaker.refused > 0) {
+                result.push_back({host, breaker.opened, breaker.refused});
+            }
+        }
+        return result;
+    }
+
+private:
+    enum class State { Closed, Open, HalfOpen };
+
+    struct Breaker {
+        State state = State::Closed;
+        size_t consecutiveFailures = 0;
+        Clock::time_point openUntil;
+        size_t opened = 0;
+        size_t refused = 0;
+    };
+
+    CircuitBreakers() {
+        const char *failures = getenv("VR_BREAKER_FAILURES");
+        threshold_ = !failures || !*failures ? 5 : string(failures) == "off" ? 0 : strtoul(failures, nullptr, 10);
+        const char *cooldown = getenv("VR_BREAKER_COOLDOWN_S");
+        cooldown_ = chrono::seconds(cooldown && *cooldown ? strtol(cooldown, nullptr, 10) : 30);
+    }
+
+    size_t threshold_;
+    chrono::seconds cooldown_;
+    map<string, Breaker> hosts_;
+    mutable std::mutex mutex_;
+};
+
+/**
+ * Function to perform an HTTP request on a prepared CURL handle
+ * 
+ * All API calls go through this function so that they can be recorded and replayed
+ * (see HttpFixtures) and get the timeouts of RequestTimeouts. The handle must already
+ * have its URL, method, body and write callback (appending to response) configured.
+ * 
+ * @param curl The prepared CURL handle
+ * @param method HTTP method, used to identify the exchange
+ * @param url Request URL, used to identify the exchange
+ * @param bodyHash fnv1aHash of the request body (or the uploaded file), used to identify the exchange
+ * @param response String or SpillBuffer receiving the response body
+ * @param httpStatus Optional output for the HTTP status code
+ * @return The CURL result code
+ */
+template <typename ResponseBody>
+CURLcode performHttpRequest(CURL *curl, const char *method, const string &url, uint64_t bodyHash,
+                            ResponseBody &response, long *httpStatus = nullptr) {
+    HttpFixtures &fixtures = HttpFixtures::instance();
+
+    // Exchanges are identified by path so recordings replay against any base URL
+    size_t hostStart = url.find("://");
+    size_t pathStart = url.find('/', hostStart == string::npos ? 0 : hostStart + 3);
+    string path = pathStart == string::npos ? "/" : url.substr(pathStart);
+
+    if (fixtures.mode() == HttpFixtures::Mode::Replay) {
+        HttpFixtures::Exchange exchange;
+        if (!fixtures.lookup(method, path, bodyHash, exchange)) {
+            cerr << "No recorded HTTP exchange for " << method << " " << path << endl;
+            return CURLE_COULDNT_CONNECT;
+        }
+        if (fixtures.replayWithOriginalTiming()) {
+            this_thread::sleep_for(chrono::microseconds(exchange.elapsedMicros));
+        }
+        response.append(exchange.response, exchange.responseLength);
+        if (httpStatus) {
+            *httpStatus = exchange.status;
+        }
+        return exchange.code;
+    }
+
+    // A job past its deadline gives up instead of occupying a worker
+    if (!RequestTimeouts::instance().apply(curl)) {
+        cerr << "Job deadline passed, not sending " << method << " " << path << endl;
+        return CURLE_OPERATION_TIMEDOUT;
+    }
+    // So does a request to a host that is known to be down
+    CircuitBreakers &breakers = CircuitBreakers::instance();
+    if (!breakers.allow(url)) {
+        cerr << "Circuit to " << CircuitBreakers::hostOf(url) << " is open, not sending " << method << " " << path << endl;
+        return CURLE_COULDNT_CONNECT;
+    }
+    SharedConnections::instance().attach(curl);
+    auto startTime = chrono::steady_clock::now();
+    CURLcode res = curl_easy_perform(curl);
+    long status = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+    if (httpStatus) {
+        *httpStatus = status;
+    }
+    breakers.recordOutcome(url, CircuitBreakers::isFailure(res, status));
+
+    if (fixtures.mode() == HttpFixtures::Mode::Record) {
+        auto elapsed = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - startTime);
+        fixtures.record(method, path, bodyHash, res, status, elapsed.count(),
+                        string_view(response.data(), response.size()));
+    }
+    return res;
+}
+
+CURLcode performHttpRequest(CURL *curl, const char *method, const string &url, const string &requestBody,
+                            string &response, long *httpStatus = nullptr) {
+    return performHttpRequest(curl, method, url, fnv1aHash(requestBody.data(), requestBody.size()), response,
+                              httpStatus);
+}
+
+/**
+ * Budget and statistics of hedged requests
+ * 
+ * A hedged request sends a duplicate when the original has not answered by the time
+ * it is expected to (see performHedgedHttpRequest). Duplicates cost money, so at most
+ * VR_HEDGE_MAX_RATE of the hedgeable requests (a fraction, e.g. 0.05; default "off",
+ * which disables hedging) may be duplicated.
+ */
+class RequestHedger {
+public:
+    struct Stats {
+        size_t requests;
+        size_t hedged;
+        size_t hedgeWins;
+    };
+
+    static RequestHedger &instance() {
+        static RequestHedger hedger;
+        return hedger;
+    }
+
+    bool enabled() const {
+        return maxRate_ > 0;
+    }
+
+    double maxRate() const {
+        return maxRate_;
+    }
+
+    // Count a request that may be hedged
+    void countRequest() {
+        lock_guard<mutex> lock(mutex_);
+        ++stats_.requests;
+    }
+
+    /**
+     * Function to claim a hedge within the rate cap
+     *
+     * @return true if a duplicate may be sent
+     */
+    bool tryHedge() {
+        lock_guard<mutex> lock(mutex_);
+        // The cap holds at every point, so the first requests of a run are not hedged
+        if (stats_.hedged + 1 > maxRate_ * stats_.requests) {
+            return false;
+        }
+        ++stats_.hedged;
+        return true;
+    }
+
+    void countHedgeWin() {
+        lock_guard<mutex> lock(mutex_);
+        ++stats_.hedgeWins;
+    }
+
+    Stats stats() const {
+        lock_guard<mutex> lock(mutex_);
+        return stats_;
+    }
+
+private:
+    RequestHedger() {
+        const char *configured = getenv("VR_HEDGE_MAX_RATE");
+        double rate = configured && *configured && string(configured) != "off" ? strtod(configured, nullptr) : 0;
+        maxRate_ = min(max(rate, 0.0), 1.0);
+    }
+
+    double maxRate_;
+    Stats stats_ = {0, 0, 0};
+    mutable std::mutex mutex_;
+};
+
+/**
+ * Function to perform an HTTP request, duplicating it if it is slow to answer
+ * 
+ * The request runs on a CURL multi handle. If no byte of the response has arrived
+ * after hedgeAfterMs and RequestHedger grants a hedge, a copy of the handle is sent
+ * as well, and the response that completes first is kept; the other transfer is
+ * abandoned. Without a delay, with hedging disabled or while replaying, this is
+ * performHttpRequest.
+ * 
+ * @param curl The prepared CURL handle, writing to response with WriteCallback
+ * @param method HTTP method, used to identify the exchange
+ * @param url Request URL, used to identify the exchange
+ * @param requestBody Request body; must outlive the call (the duplicate shares it)
+ * @param response String receiving the response body
+ * @param httpStatus Optional output for the HTTP status code
+ * @param hedgeAfterMs Time without a response before the duplicate is sent (0 never hedges)
+ * @return The CURL result code of the kept response
+ */
+CURLcode performHedgedHttpRequest(CURL *curl, const char *method, const string &url, const string &requestBody,
+                                  string &response, long *httpStatus, double hedgeAfterMs) {
+    HttpFixtures &fixtures = HttpFixtures::instance();
+    RequestHedger &hedger = RequestHedger::instance();
+    if (hedgeAfterMs <= 0 || !hedger.enabled() || fixtures.mode() == HttpFixtures::Mode::Replay) {
+        return performHttpRequest(curl, method, url, requestBody, response, httpStatus);
+    }
+
+    size_t hostStart = url.find("://");
+    size_t pathStart = url.find('/', hostStart == string::npos ? 0 : hostStart + 3);
+    string path = pathStart == string::npos ? "/" : url.substr(pathStart);
+    if (!RequestTimeouts::instance().apply(curl)) {
+        cerr << "Job deadline passed, not sending " << method << " " << path << endl;
+        return CURLE_OPERATION_TIMEDOUT;
+    }
+    CircuitBreakers &breakers = CircuitBreakers::instance();
+    if (!breakers.allow(url)) {
+        cerr << "Circuit to " << CircuitBreakers::hostOf(url) << " is open, not sending " << method << " " << path << endl;
+        return CURLE_COULDNT_CONNECT;
+    }
+    hedger.countRequest();
+    // The duplicate inherits the shared caches from the handle
+    SharedConnections::instance().attach(curl);
+
+    auto startTime = chrono::steady_clock::now();
+    auto hedgeTime = startTime + chrono::microseconds(static_cast<int64_t>(hedgeAfterMs * 1000));
+    CURLM *multi = curl_multi_init();
+    curl_multi_add_handle(multi, curl);
+    CURL *hedge = nullptr;
+    string hedgeResponse;
+    bool hedgeDecided = false;
+    CURL *winner = nullptr;
+    CURLcode res = CURLE_OK;
+    int running = 1;
+
+    while (!winner && running > 0) {
+        curl_multi_perform(multi, &running);
+        CURLMsg *message;
+        int queued;
+        while (!winner && (message = curl_multi_info_read(multi, &queued))) {
+            if (message->msg != CURLMSG_DONE) {
+                continue;
+            }
+            res = message->data.result;
+            // A transfer that failed outright leaves the other one to answer
+            if (res == CURLE_OK || running == 0) {
+                winner = message->easy_handle;
+            }
+        }
+        if (winner || running == 0) {
+            break;
+        }
+
+        if (!hedgeDecided && chrono::steady_clock::now() >= hedgeTime) {
+            hedgeDecided = true;
+            curl_off_t firstByteMicros = 0;
+            curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME_T, &firstByteMicros);
+            if (firstByteMicros == 0 && hedger.tryHedge() && (hedge = curl_easy_duphandle(curl))) {
+                curl_easy_setopt(hedge, CURLOPT_WRITEDATA, &hedgeResponse);
+                if (RequestTimeouts::instance().apply(hedge)) {
+                    cout << "No response to " << method << " " << path << " after " << fixed << setprecision(0)
+                         << hedgeAfterMs << " ms, sending a hedged request" << endl;
+                    curl_multi_add_handle(multi, hedge);
+                    ++running;
+                } else {
+                    curl_easy_cleanup(hedge);
+                    hedge = nullptr;
+                }
+            }
+        }
+
+        int waitMs = 100;
+        if (!hedgeDecided) {
+            auto untilHedge = chrono::duration_cast<chrono::milliseconds>(hedgeTime - chrono::steady_clock::now());
+            waitMs = static_cast<int>(max<int64_t>(1, min<int64_t>(waitMs, untilHedge.count())));
+        }
+        curl_multi_poll(multi, nullptr, 0, waitMs, nullptr);
+    }
+    if (!winner) {
+        winner = curl;
+    }
+
+    long status = 0;
+    curl_easy_getinfo(winner, CURLINFO_RESPONSE_CODE, &status);
+    if (httpStatus) {
+        *httpStatus = status;
+    }
+    breakers.recordOutcome(url, CircuitBreakers::isFailure(res, status));
+    bool hedgeWon = hedge && winner == hedge;
+    curl_multi_remove_handle(multi, curl);
+    if (hedge) {
+        curl_multi_remove_handle(multi, hedge);
+        curl_easy_cleanup(hedge);
+    }
+    curl_multi_cleanup(multi);
+    if (hedgeWon) {
+        response = move(hedgeResponse);
+        hedger.countHedgeWin();
+    }
+
+    if (fixtures.mode() == HttpFixtures::Mode::Record) {
+        auto elapsed = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - startTime);
+        fixtures.record(method, path, fnv1aHash(requestBody.data(), requestBody.size()), res, status,
+                        elapsed.count(), string_view(response.data(), response.size()));
+    }
+    return res;
+}
+
+/**
+ * Streaming extractor for selected fields of a JSON document
+ * 
+ * The API responses handled here are large and verbose, but the application only
+ * needs a handful of string fields from them. Instead of building a full DOM with
+ * json::parse, this SAX handler walks the document once, tracks the current path and
+ * moves only the registered string values out of the parser. Everything else is
+ * skipped without allocating JSON nodes.
+ * 
+ * Paths are dot-separated, with numeric segments matching array indices
+ * (e.g. "choices.0.message.content"). A "*" segment matches any object key; values
+ * under such patterns are passed to a handler together with the matched key.
+ */
+class JsonFieldExtractor : public nlohmann::json_sax<json> {
+public:
+    // Register a field whose string value is moved into output; returns its id for found()
+    size_t addField(const std::string &path, std::string *output) {
+        targets_.push_back({compilePath(path), output, nullptr, false});
+        return targets_.size() - 1;
+    }
+
+    // Register a pattern containing one "*" segment; handler receives the matched key and value
+    void addFieldPattern(const std::string &path, function<void(const std::string&, std::string&)> handler) {
+        targets_.push_back({compilePath(path), nullptr, move(handler), false});
+        hasPatterns_ = true;
+    }
+
+    /**
+     * Parse a document and extract the registered fields
+     * 
+     * Parsing stops as soon as every plain field has been found (unless patterns are registered).
+     * 
+     * @return true if the document was valid JSON up to the point parsing stopped
+     */
+    bool parse(const char *begin, const char *end) {
+        frames_.clear();
+        error_.clear();
+        remaining_ = 0;
+        for (auto &target : targets_) {
+            target.found = false;
+            if (target.output) {
+                ++remaining_;
+            }
+        }
+        stoppedEarly_ = false;
+        bool completed = json::sax_parse(begin, end, this);
+        return completed || stoppedEarly_;
+    }
+
+    bool parse(const std::string &input) {
+        return parse(input.data(), input.data() + input.size());
+    }
+
+    bool found(size_t id) const {
+        return targets_[id].found;
+    }
+
+    // Description of the parse error, if parse() returned false
+    const std::string &error() const {
+        return error_;
+    }
+
+    // SAX interface
+    bool null() override { return scalar(nullptr); }
+    bool boolean(bool) override { return scalar(nullptr); }
+    bool number_integer(number_integer_t) override { return scalar(nullptr); }
+    bool number_unsigned(number_unsigned_t) override { return scalar(nullptr); }
+    bool number_float(number_float_t, const string_t&) override { return scalar(nullptr); }
+    bool string(string_t &value) override { return scalar(&value); }
+    bool binary(binary_t&) override { return scalar(nullptr); }
+
+    bool start_object(size_t) override {
+        frames_.push_back({false, 0, {}});
+        return true;
+    }
+
+    bool key(string_t &value) override {
+        frames_.back().key = move(value);
+        return true;
+    }
+
+    bool end_object() override {
+        frames_.pop_back();
+        return valueDone();
+    }
+
+    bool start_array(size_t) override {
+        frames_.push_back({true, 0, {}});
+        return true;
+    }
+
+    bool end_array() override {
+        frames_.pop_back();
+        return valueDone();
+    }
+
+    bool parse_error(size_t position, const std::string&, const nlohmann::detail::exception &ex) override {
+        error_ = "at byte " + to_string(position) + ": " + ex.what();
+        return false;
+    }
+
+private:
+    struct PathSegment {
+        std::string key;
+        long index;      // Array index, or -1 if the segment cannot match an array element
+        bool wildcard;
+    };
+
+    struct Frame {
+        bool isArray;
+        size_t index;
+        std::string key;
+    };
+
+    struct Target {
+        vector<PathSegment> path;
+        std::string *output;
+        function<void(const std::string&, std::string&)> handler;
+        bool found;
+    };
+
+    static vector<PathSegment> compilePath(const std::string &path) {
+        vector<PathSegment> segments;
+        size_t start = 0;
+        while (start <= path.size()) {
+            size_t dot = path.find('.', start);
+            if (dot == std::string::npos) {
+                dot = path.size();
+            }
+            std::string segment = path.substr(start, dot - start);
+            bool numeric = !segment.empty() && segment.find_first_not_of("0123456789") == std::string::npos;
+            segments.push_back({segment, numeric ? stol(segment) : -1, segment == "*"});
+            start = dot + 1;
+        }
+        return segments;
+    }
+
+    // Check whether the current location matches a target path; records the wildcard key
+    bool matches(const Target &target, const std::string **wildcardKey) const {
+        if (target.path.size() != frames_.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < frames_.size(); ++i) {
+            const PathSegment &segment = target.path[i];
+            const Frame &frame = frames_[i];
+            if (frame.isArray) {
+                if (segment.index < 0 || static_cast<size_t>(segment.index) != frame.index) {
+                    return false;
+                }
+            } else if (segment.wildcard) {
+                *wildcardKey = &frame.key;
+            } else if (segment.key != frame.key) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool scalar(string_t *value) {
+        if (value && !frames_.empty()) {
+            for (auto &target : targets_) {
+                const std::string *wildcardKey = nullptr;
+                if (!matches(target, &wildcardKey)) {
+                    continue;
+                }
+                if (target.output) {
+                    if (!target.found) {
+                        *target.output = move(*value);
+                        target.found = true;
+                        --remaining_;
+                    }
+                } else if (wildcardKey) {
+                    target.handler(*wildcardKey, *value);
+                }
+                break;
+            }
+        }
+        return valueDone();
+    }
+
+    // Advance the array index after a complete value and stop once nothing is left to find
+    bool valueDone() {
+        if (!frames_.empty() && frames_.back().isArray) {
+            ++frames_.back().index;
+        }
+        if (remaining_ == 0 && !hasPatterns_ && !targets_.empty()) {
+            stoppedEarly_ = true;
+            return false;
+        }
+        return true;
+    }
+
+    vector<Target> targets_;
+    vector<Frame> frames_;
+    size_t remaining_ = 0;
+    bool hasPatterns_ = false;
+    bool stoppedEarly_ = false;
+    std::string error_;
+};
+
+/**
+ * Transcript with word and segment timings in struct-of-arrays form
+ * 
+ * A multi-hour recording has tens of thousands of words. Instead of one JSON object
+ * per word, each word and segment is an (offset, length) span into one shared text
+ * buffer plus integer start and end times in milliseconds: 16 bytes per span on top
+ * of its text, in arrays that can be scanned or binary-searched by time.
+ */
+struct TimedTranscript {
+    struct Spans {
+        vector<uint32_t> offsets;
+        vector<uint32_t> lengths;
+        vector<uint32_t> startMs;
+        vector<uint32_t> endMs;
+
+        size_t size() const {
+            return offsets.size();
+        }
+    };
+
+    string text;        // Full transcript as returned by the API
+    string buffer;      // Text of every word and segment
+    Spans words;
+    Spans segments;
+    uint32_t durationMs = 0;
+
+    void addSpan(Spans &spans, const std::string &spanText, double startSeconds, double endSeconds) {
+        spans.offsets.push_back(buffer.size());
+        spans.lengths.push_back(spanText.size());
+        spans.startMs.push_back(toMilliseconds(startSeconds));
+        spans.endMs.push_back(toMilliseconds(endSeconds));
+        buffer += spanText;
+    }
+
+    string_view spanText(const Spans &spans, size_t index) const {
+        return string_view(buffer).substr(spans.offsets[index], spans.lengths[index]);
+    }
+
+    bool empty() const {
+        return words.size() == 0 && segments.size() == 0;
+    }
+
+    // Bytes held by the timing data, excluding the full transcript text
+    size_t memoryBytes() const {
+        return buffer.capacity() + (words.offsets.capacity() + segments.offsets.capacity()) * 4 * sizeof(uint32_t);
+    }
+
+    static uint32_t toMilliseconds(double seconds) {
+        return seconds > 0 ? static_cast<uint32_t>(llround(seconds * 1000.0)) : 0;
+    }
+};
+
+/**
+ * SAX handler filling a TimedTranscript from a verbose_json transcription response
+ * 
+ * Reads "text", "duration", and "word"/"start"/"end" of every element of "words" and
+ * "text"/"start"/"end" of every element of "segments". Token lists and other fields
+ * are skipped without being materialized.
+ */
+class TimedTranscriptParser : public nlohmann::json_sax<json> {
+public:
+    explicit TimedTranscriptParser(TimedTranscript &transcript) : transcript_(transcript) {}
+
+    /**
+     * Parse a verbose_json response
+     * 
+     * @param begin Start of the response body
+     * @param end End of the response body
+     * @return true if the response was valid JSON
+     */
+    bool parse(const char *begin, const char *end) {
+        error_.clear();
+        return json::sax_parse(begin, end, this);
+    }
+
+    bool parse(const std::string &input) {
+        return parse(input.data(), input.data() + input.size());
+    }
+
+    // Description of the parse error, if parse() returned false
+    const std::string &error() const {
+        return error_;
+    }
+
+    // SAX interface
+    bool null() override { return true; }
+    bool boolean(bool) override { return true; }
+    bool number_integer(number_integer_t value) override { return number(static_cast<double>(value)); }
+    bool number_unsigned(number_unsigned_t value) override { return number(static_cast<double>(value)); }
+    bool number_float(number_float_t value, const string_t&) override { return number(value); }
+    bool binary(binary_t&) override { return true; }
+
+    bool string(string_t &value) override {
+        if (depth_ == 1 && key_ == "text") {
+            transcript_.text = move(value);
+        } else if (depth_ == 3 && list_ != List::None && key_ == (list_ == List::Words ? "word" : "text")) {
+            elementText_ = move(value);
+        }
+        return true;
+    }
+
+    bool start_object(size_t) override {
+        if (++depth_ == 3) {
+            elementText_.clear();
+            elementStart_ = elementEnd_ = 0;
+        }
+        return true;
+    }
+
+    bool key(string_t &value) override {
+        key_ = move(value);
+        return true;
+    }
+
+    bool end_object() override {
+        if (depth_-- == 3 && list_ != List::None) {
+            transcript_.addSpan(list_ == List::Words ? transcript_.words : transcript_.segments,
+                                elementText_, elementStart_, elementEnd_);
+        }
+        return true;
+    }
+
+    bool start_array(size_t) override {
+        if (++depth_ == 2) {
+            list_ = key_ == "words" ? List::Words : key_ == "segments" ? List::Segments : List::None;
+        }
+        return true;
+    }
+
+    bool end_array() override {
+        if (depth_-- == 2) {
+            list_ = List::None;
+        }
+        return true;
+    }
+
+    bool parse_error(size_t position, const std::string&, const nlohmann::detail::exception &ex) override {
+        error_ = "at byte " + to_string(position) + ": " + ex.what();
+        return false;
+    }
+
+private:
+    enum class List { None, Words, Segments };
+
+    bool number(double value) {
+        if (depth_ == 1 && key_ == "duration") {
+            transcript_.durationMs = TimedTranscript::toMilliseconds(value);
+        } else if (depth_ == 3 && list_ != List::None) {
+            if (key_ == "start") {
+                elementStart_ = value;
+            } else if (key_ == "end") {
+                elementEnd_ = value;
+            }
+        }
+        return true;
+    }
+
+    TimedTranscript &transcript_;
+    int depth_ = 0;
+    List list_ = List::None;
+    std::string key_;
+    std::string elementText_;
+    double elementStart_ = 0;
+    double elementEnd_ = 0;
+    std::string error_;
+};
+
+/**
+ * Function to read the requested transcript timestamp granularities
+ * 
+ * VR_TRANSCRIPT_TIMESTAMPS holds a comma-separated list of "word" and "segment".
+ * When it is unset, only the plain transcript text is requested.
+ * 
+ * @return The granularities to request, empty for plain text
+ */
+vector<string> transcriptTimestampGranularities() {
+    vector<string> granularities;
+    const char *configured = getenv("VR_TRANSCRIPT_TIMESTAMPS");
+    if (!configured) {
+        return granularities;
+    }
+    stringstream list(configured);
+    string granularity;
+    while (getline(list, granularity, ',')) {
+        if (granularity == "word" || granularity == "segment") {
+            granularities.push_back(granularity);
+        } else if (!granularity.empty() && granularity != "off") {
+            cerr << "Ignoring unknown timestamp granularity: " << granularity << endl;
+        }
+    }
+    return granularities;
+}
+
+/**
+ * Function to transcribe audio using the OpenAI Whisper API
+ * 
+ * This function sends an audio file to the OpenAI Whisper API for transcription.
+ * It handles:
+ * 1. Streaming the audio file from disk into the upload, without buffering it
+ * 2. Setting up the API request with proper headers and parameters
+ * 3. Sending the request to the API
+ * 4. Receiving the response into a SpillBuffer, which moves a very large response to disk
+ * 
+ * @param filePath Path to the audio file to transcribe
+ * @param apiKey OpenAI API key for authentication
+ * @param response Receives the API response containing the transcription
+ * @param timestampGranularities "word" and/or "segment" to request a verbose_json
+ *        response with timings; empty for the plain transcript
+ * @return true if the request completed, false otherwise
+ */
+bool transcribeAudio(const string &filePath, const string &apiKey, SpillBuffer &response,
+                     const vector<string> &timestampGranularities = {}) {
+    // The upload is identified by the file's content; hashing the mapping keeps it off the heap
+    MappedFile audio(filePath);
+    if (!audio.isOpen()) {
+        cerr << "Failed to open file: " << filePath << endl;
+        return false;
+    }
+    uint64_t bodyHash = fnv1aHash(audio.data(), audio.size());
+
+    CURL *curl;
+    CURLcode res = CURLE_FAILED_INIT;
+    curl = curl_easy_init();
+    if (curl) {
+        // Set up the header with the API key
+        struct curl_slist *headers = nullptr;
+        headers = curl_slist_append(headers, ("Authorization: Bearer " + apiKey).c_str());
+
+        // Set the API endpoint for transcription
+        string url = openAiBaseUrl() + "/v1/audio/transcriptions";
+        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+        curl_easy_setopt(curl, CURLOPT_POST, 1L);
+
+        // Set up MIME form for file upload and model parameter
+        curl_mime *form = curl_mime_init(curl);
+
+        // Add the file field to the form; curl reads it from disk while sending
+        curl_mimepart *field = curl_mime_addpart(form);
+        curl_mime_name(field, "file");
+        curl_mime_filedata(field, filePath.c_str());
+        curl_mime_filename(field, filePath.c_str());
+
+        // Add the model parameter
+        field = curl_mime_addpart(form);
+        curl_mime_name(field, "model");
+        curl_mime_data(field, "whisper-1", CURL_ZERO_TERMINATED);
+
+        // Request word and/or segment timings if configured
+        if (!timestampGranularities.empty()) {
+            field = curl_mime_addpart(form);
+            curl_mime_name(field, "response_format");
+            curl_mime_data(field, "verbose_json", CURL_ZERO_TERMINATED);
+            for (const string &granularity : timestampGranularities) {
+                field = curl_mime_addpart(form);
+                curl_mime_name(field, "timestamp_granularities[]");
+                curl_mime_data(field, granularity.c_str(), CURL_ZERO_TERMINATED);
+            }
+        }
+
+        // Attach the form and set callback for response
+        curl_easy_setopt(curl, CURLOPT_MIMEPOST, form);
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, SpillWriteCallback);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
+
+        // Perform the request
+        res = performHttpRequest(curl, "POST", url, bodyHash, response);
+        if (res != CURLE_OK) {
+            cerr << "CURL error (transcription): " << curl_easy_strerror(res) << endl;
+        }
+
+        // Clean up
+        curl_mime_free(form);
+        curl_slist_free_all(headers);
+        curl_easy_cleanup(curl);
+    }
+    return res == CURLE_OK;
+}
+
+/**
+ * Speech-to-text engine behind transcribeToText
+ * 
+ * A backend answers in the shape of the OpenAI transcription API: {"text": ...}, or
+ * verbose_json with "duration", "words" and "segments" when timings are requested,
+ * so the rest of the pipeline does not depend on where the transcript came from.
+ */
+class TranscriptionBackend {
+public:
+    virtual ~TranscriptionBackend() = default;
+
+    virtual const char *name() const = 0;
+
+    // Whether the backend runs on this machine (and competes for its CPU) rather than an API
+    virtual bool runsLocally() const {
+        return false;
+    }
+
+    /**
+     * Function to transcribe an audio file
+     *
+     * @param filePath Path to the audio file
+     * @param response Receives the transcription response
+     * @param timestampGranularities "word" and/or "segment" for a verbose_json response
+     * @return true if the transcription completed
+     */
+    virtual bool transcribe(const string &filePath, SpillBuffer &response,
+                            const vector<string> &timestampGranularities) = 0;
+};
+
+/**
+ * Transcription with the OpenAI API (see transcribeAudio)
+ */
+class OpenAiTranscriptionBackend : public TranscriptionBackend {
+public:
+    explicit OpenAiTranscriptionBackend(const string &apiKey) : apiKey_(apiKey) {}
+
+    const char *name() const override {
+        return "api";
+    }
+
+    bool transcribe(const string &filePath, SpillBuffer &response,
+                    const vector<string> &timestampGranularities) override {
+        return transcribeAudio(filePath, apiKey_, response, timestampGranularities);
+    }
+
+private:
+    string apiKey_;
+};
+
+/**
+ * Function to transcribe an audio file and extract the transcription text
+ * 
+ * @param backend The engine to transcribe with
+ * @param filePath Path to the audio file to transcribe
+ * @param parsed Set to true if the text was extracted, false if the raw response is returned instead
+ * @param timings If given and VR_TRANSCRIPT_TIMESTAMPS requests timings, receives the word
+ *        and segment timings
+ * @return The transcription text, or the raw API response if it could not be parsed
+ */
+string transcribeToText(TranscriptionBackend &backend, const string &filePath, bool &parsed,
+                        TimedTranscript *timings = nullptr) {
+    vector<string> granularities = timings ? transcriptTimestampGranularities() : vector<string>();
+    SpillBuffer transcriptionResponse;
+    backend.transcribe(filePath, transcriptionResponse, granularities);
+    const char *responseBegin = transcriptionResponse.data();
+    const char *responseEnd = responseBegin + transcriptionResponse.size();
+    
+    // Parse the transcription JSON to extract the transcription text
+    string transcriptionText;
+    string parseError;
+    if (granularities.empty()) {
+        JsonFieldExtractor transcriptionExtractor;
+        // The transcription text is in the "text" field
+        size_t textField = transcriptionExtractor.addField("text", &transcriptionText);
+        parsed = transcriptionExtractor.parse(responseBegin, responseEnd) && transcriptionExtractor.found(textField);
+        parseError = transcriptionExtractor.error();
+    } else {
+        // Timings are read straight into the compact layout, without a JSON node per word
+        TimedTranscriptParser timingParser(*timings);
+        parsed = timingParser.parse(responseBegin, responseEnd) && !timings->text.empty();
+        parseError = timingParser.error();
+        transcriptionText = timings->text;
+    }
+    if (parsed) {
+        cout << "Transcription:" << endl << transcriptionText << endl;
+        if (timings && !timings->empty()) {
+            cout << "Timings: " << timings->words.size() << " words, " << timings->segments.size()
+                 << " segments (" << timings->memoryBytes() << " bytes)" << endl;
+        }
+    } else {
+        cerr << "Error parsing transcription JSON response: "
+             << (parseError.empty() ? "no text field" : parseError) << endl;
+        transcriptionText.assign(responseBegin, responseEnd); // Fallback to raw response if parsing fails
+        cout << "Raw transcription response:" << endl << transcriptionText << endl;
+    }
+    return transcriptionText;
+}
+
+/**
+ * Function to close every descriptor but stdin, stdout and stderr in a forked child
+ * 
+ * Other threads open sockets, pipes and temporary files at any time, some without
+ * O_CLOEXEC, and a child must not keep them open: a decoder holding the write end of
+ * another job's pipe would keep that job from ever reading end of file. Only
+ * async-signal-safe calls are made, as required in the child of a threaded process.
+ */
+void closeInheritedDescriptors() {
+#ifdef SYS_close_range
+    if (syscall(SYS_close_range, 3u, ~0u, 0u) == 0) {
+        return;
+    }
+#endif
+    struct rlimit limit;
+    int maxFd = getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY
+                    ? static_cast<int>(min<rlim_t>(limit.rlim_cur, 65536)) : 65536;
+    for (int fd = 3; fd < maxFd; ++fd) {
+        close(fd);
+    }
+}
+
+/**
+ * Function to decode an audio file to mono floating-point PCM
+ * 
+ * Decoding is delegated to ffmpeg, which handles every container and codec the
+ * transcription API accepts. Samples are streamed from its stdout through a pipe.
+ * 
+ * @param filePath Path to the audio file
+ * @param sampleRate Target sample rate in Hz
+ * @param samples Receives the decoded samples in [-1, 1)
+ * @return true if decoding succeeded, false otherwise (e.g. ffmpeg is not installed)
+ */
+bool decodeAudioToPcm(const string &filePath, int sampleRate, vector<float> &samples) {
+    // Close-on-exec, so that children forked by other jobs do not inherit the pipe
+    int pipeFds[2];
+    if (pipe2(pipeFds, O_CLOEXEC) != 0) {
+        return false;
+    }
+    string rate = to_string(sampleRate);
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(pipeFds[0]);
+        close(pipeFds[1]);
+        return false;
+    }
+    if (pid == 0) {
+        // Child process: ffmpeg writes raw 16-bit little-endian samples to the pipe
+        dup2(pipeFds[1], STDOUT_FILENO);
+        int devNull = open("/dev/null", O_RDWR);
+        if (devNull >= 0) {
+            dup2(devNull, STDIN_FILENO);
+            dup2(devNull, STDERR_FILENO);
+        }
+        closeInheritedDescriptors();
+        execlp("ffmpeg", "ffmpeg", "-v", "error", "-nostdin", "-i", filePath.c_str(), "-vn", "-ac", "1",
+               "-ar", rate.c_str(), "-f", "s16le", "-", static_cast<char*>(nullptr));
+        _exit(127);
+    }
+
+    close(pipeFds[1]);
+    samples.clear();
+    int16_t buffer[32768];
+    size_t carry = 0;
+    while (true) {
+        ssize_t bytesRead = read(pipeFds[0], reinterpret_cast<char*>(buffer) + carry, sizeof(buffer) - carry);
+        if (bytesRead < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytesRead <= 0) {
+            break;
+        }
+        size_t available = carry + bytesRead;
+        size_t count = available / sizeof(int16_t);
+        for (size_t i = 0; i < count; ++i) {
+            samples.push_back(buffer[i] * (1.0f / 32768.0f));
+        }
+        // Keep an odd trailing byte for the next read
+        carry = available % sizeof(int16_t);
+        if (carry) {
+            reinterpret_cast<char*>(buffer)[0] = reinterpret_cast<char*>(buffer)[available - 1];
+        }
+    }
+    close(pipeFds[0]);
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 && !samples.empty();
+}
+
+/**
+ * Offline transcription with a local whisper.cpp build
+ * 
+ * Runs the whisper.cpp command-line tool (VR_WHISPER_CLI, default "whisper-cli") on
+ * the recording, decoded to 16 kHz mono WAV. whisper.cpp runs Whisper models with
+ * quantized weights (VR_WHISPER_MODEL, default models/ggml-base.en-q5_1.bin), SIMD
+ * matrix kernels and multithreaded decoding (VR_WHISPER_THREADS, default every core).
+ * VR_WHISPER_LANGUAGE sets the spoken language (default "auto"). The audio never
+ * leaves the machine, and the job is not subject to network latency or API outages.
+ */
+class WhisperCppTranscriptionBackend : public TranscriptionBackend {
+public:
+    static const int kSampleRate = 16000;
+
+    WhisperCppTranscriptionBackend()
+        : executable_(setting("VR_WHISPER_CLI", "whisper-cli")),
+          model_(setting("VR_WHISPER_MODEL", "models/ggml-base.en-q5_1.bin")),
+          language_(setting("VR_WHISPER_LANGUAGE", "auto")) {
+        const char *threads = getenv("VR_WHISPER_THREADS");
+        threads_ = threads && strtoul(threads, nullptr, 10) > 0 ? strtoul(threads, nullptr, 10)
+                                                               : max(1u, thread::hardware_concurrency());
+    }
+
+    const char *name() const override {
+        return "local";
+    }
+
+    bool runsLocally() const override {
+        return true;
+    }
+
+    bool transcribe(const string &filePath, SpillBuffer &response,
+                    const vector<string> &timestampGranularities) override {
+        vector<float> samples;
+        if (!decodeAudioToPcm(filePath, kSampleRate, samples)) {
+            cerr << "Could not decode audio for local transcription (is ffmpeg installed?)" << endl;
+            return false;
+        }
+        string wavPath = (std::filesystem::temp_directory_path() / "vr_whisper_XXXXXX.wav").string();
+        int fd = mkstemps(&wavPath[0], 4);
+        if (fd < 0) {
+            cerr << "Failed to create a temporary file for local transcription" << endl;
+            return false;
+        }
+        string outputPrefix = wavPath.substr(0, wavPath.size() - 4);
+        string jsonPath = outputPrefix + ".json";
+        bool written = writeWav(fd, samples);
+        close(fd);
+
+        bool wantWords = find(timestampGranularities.begin(), timestampGranularities.end(), "word")
+                         != timestampGranularities.end();
+        string threads = to_string(threads_);
+        vector<string> arguments = {executable_, "-m", model_, "-f", wavPath, "-t", threads, "-l", language_,
+                                    "-np", wantWords ? "-ojf" : "-oj", "-of", outputPrefix};
+        bool succeeded = written && runProcess(arguments);
+        unlink(wavPath.c_str());
+
+        json output;
+        if (succeeded) {
+            ifstream file(jsonPath);
+            output = json::parse(file, nullptr, false);
+            succeeded = !output.is_discarded() && output.contains("transcription");
+        }
+        unlink(jsonPath.c_str());
+        if (!succeeded) {
+            cerr << "Local transcription with " << executable_ << " failed (model " << model_ << ")" << endl;
+            return false;
+        }
+        string converted = toApiResponse(output, static_cast<double>(samples.size()) / kSampleRate,
+                                         timestampGranularities, wantWords).dump();
+        return response.append(converted.data(), converted.size());
+    }
+
+private:
+    static string setting(const char *variable, const char *defaultValue) {
+        const char *configured = getenv(variable);
+        return configured && *configured ? configured : defaultValue;
+    }
+
+    // 16-bit PCM WAV, as whisper.cpp expects it
+    static bool writeWav(int fd, const vector<float> &samples) {
+        uint32_t dataBytes = static_cast<uint32_t>(samples.size() * sizeof(int16_t));
+        string header = "RIFF";
+        auto appendLe = [&header](uint32_t value, size_t bytes) {
+            for (size_t i = 0; i < bytes; ++i) {
+                header.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+            }
+        };
+        appendLe(36 + dataBytes, 4);
+        header += "WAVEfmt ";
+        appendLe(16, 4);
+        appendLe(1, 2);                              // PCM
+        appendLe(1, 2);                              // mono
+        appendLe(kSampleRate, 4);
+        appendLe(kSampleRate * sizeof(int16_t), 4);  // byte rate
+        appendLe(sizeof(int16_t), 2);                // block align
+        appendLe(16, 2);                             // bits per sample
+        header += "data";
+        appendLe(dataBytes, 4);
+
+        vector<int16_t> pcm(samples.size());
+        for (size_t i = 0; i < samples.size(); ++i) {
+            pcm[i] = static_cast<int16_t>(lrintf(min(max(samples[i], -1.0f), 1.0f) * 32767.0f));
+        }
+        return write(fd, header.data(), header.size()) == static_cast<ssize_t>(header.size())
+               && write(fd, pcm.data(), dataBytes) == static_cast<ssize_t>(dataBytes);
+    }
+
+    // Run the tool, killing it if the job's deadline passes first
+    static bool runProcess(const vector<string> &arguments) {
+        // Built before forking: the child of a threaded process must not allocate
+        vector<char*> argv;
+        for (const string &argument : arguments) {
+            argv.push_back(const_cast<char*>(argument.c_str()));
+        }
+        argv.push_back(nullptr);
+        pid_t pid = fork();
+        if (pid < 0) {
+            return false;
+        }
+        if (pid == 0) {
+            int devNull = open("/dev/null", O_RDWR);
+            if (devNull >= 0) {
+                dup2(devNull, STDIN_FILENO);
+                dup2(devNull, STDOUT_FILENO);
+                dup2(devNull, STDERR_FILENO);
+            }
+            closeInheritedDescriptors();
+            execvp(argv[0], argv.data());
+            _exit(127);
+        }
+
+        RequestTimeouts::Clock::time_point deadline = RequestTimeouts::currentDeadline();
+        int status = 0;
+        while (waitpid(pid, &status, WNOHANG) == 0) {
+            if (RequestTimeouts::Clock::now() >= deadline) {
+                cerr << "Job deadline passed, stopping local transcription" << endl;
+                kill(pid, SIGKILL);
+                waitpid(pid, &status, 0);
+                return false;
+            }
+            this_thread::sleep_for(chrono::milliseconds(20));
+        }
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 127) {
+            cerr << "Could not run " << arguments[0] << " (is whisper.cpp installed?)" << endl;
+        }
+        return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+
+    // Convert whisper.cpp's JSON output to the OpenAI transcription response
+    static json toApiResponse(const json &output, double durationSeconds,
+                              const vector<string> &timestampGranularities, bool wantWords) {
+        string text;
+        json segments = json::array();
+        json words = json::array();
+        for (const auto &segment : output["transcription"]) {
+            string segmentText = segment.value("text", "");
+            text += segmentText;
+            const json &offsets = segment.value("offsets", json::object());
+            segments.push_back({{"start", offsets.value("from", 0) / 1000.0},
+                                {"end", offsets.value("to", 0) / 1000.0},
+                                {"text", segmentText}});
+            if (!wantWords) {
+                continue;
+            }
+            // Tokens starting with a space begin a word; "[_...]" tokens are timestamps and markers
+            for (const auto &token : segment.value("tokens", json::array())) {
+                string tokenText = token.value("text", "");
+                size_t wordStart = tokenText.find_first_not_of(' ');
+                if (wordStart == string::npos || tokenText.compare(0, 2, "[_") == 0) {
+                    continue;
+                }
+                const json &tokenOffsets = token.value("offsets", json::object());
+                double start = tokenOffsets.value("from", 0) / 1000.0;
+                double end = tokenOffsets.value("to", 0) / 1000.0;
+                if (wordStart > 0 || words.empty()) {
+                    words.push_back({{"word", tokenText.substr(wordStart)}, {"start", start}, {"end", end}});
+                } else {
+                    words.back()["word"] = words.back()["word"].get<string>() + tokenText;
+                    words.back()["end"] = end;
+                }
+            }
+        }
+        size_t textStart = text.find_first_not_of(' ');
+        json response = {{"text", textStart == string::npos ? "" : text.substr(textStart)}};
+        if (!timestampGranularities.empty()) {
+            response["duration"] = durationSeconds;
+            if (find(timestampGranularities.begin(), timestampGranularities.end(), "segment")
+                != timestampGranularities.end()) {
+                response["segments"] = segments;
+            }
+            if (wantWords) {
+                response["words"] = words;
+            }
+        }
+        return response;
+    }
+
+    string executable_;
+    string model_;
+    string language_;
+    size_t threads_;
+};
+
+/**
+ * Function to create a transcription backend
+ * 
+ * @param name "api" (OpenAI) or "local" (whisper.cpp)
+ * @param apiKey OpenAI API key, used by the API backend
+ * @return The backend, or nullptr if the name is unknown
+ */
+unique_ptr<TranscriptionBackend> makeTranscriptionBackend(const string &name, const string &apiKey) {
+    if (name == "api") {
+        return make_unique<OpenAiTranscriptionBackend>(apiKey);
+    }
+    if (name == "local") {
+        return make_unique<WhisperCppTranscriptionBackend>();
+    }
+    return nullptr;
+}
+
+/**
+ * Default transcription backend of a job (VR_TRANSCRIPTION_BACKEND, "api" or "local";
+ * default "api")
+ */
+string defaultTranscriptionBackend() {
+    const char *configured = getenv("VR_TRANSCRIPTION_BACKEND");
+    return configured && *configured ? configured : "api";
+}
+
+/**
+ * Radix-2 FFT computing power spectra of fixed-size real frames
+ * 
+ * Real and imaginary parts are kept in separate arrays, and the twiddle factors of each
+ * butterfly stage are stored contiguously, so every inner loop walks unit-stride
+ * float arrays that the compiler vectorizes with SIMD instructions.
+ */
+class PowerSpectrumFft {
+public:
+    explicit PowerSpectrumFft(size_t size) : size_(size), bitReverse_(size), window_(size), real_(size), imag_(size) {
+        size_t bits = 0;
+        while ((size_t(1) << bits) < size) {
+            ++bits;
+        }
+        for (size_t i = 0; i < size; ++i) {
+            size_t reversed = 0;
+            for (size_t b = 0; b < bits; ++b) {
+                reversed |= ((i >> b) & 1) << (bits - 1 - b);
+            }
+            bitReverse_[i] = reversed;
+            // Hann window
+            window_[i] = 0.5f - 0.5f * cos(2.0 * M_PI * i / (size - 1));
+        }
+        for (size_t half = 1; half < size; half *= 2) {
+            for (size_t j = 0; j < half; ++j) {
+                double angle = -M_PI * j / half;
+                twiddleReal_.push_back(cos(angle));
+                twiddleImag_.push_back(sin(angle));
+            }
+        }
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+    // Compute |X[k]|^2 for k = 0 .. size/2 of a windowed frame
+    void powerSpectrum(const float *frame, float *power) {
+        float *__restrict re = real_.data();
+        float *__restrict im = imag_.data();
+        for (size_t i = 0; i < size_; ++i) {
+            size_t source = bitReverse_[i];
+            re[i] = frame[source] * window_[source];
+            im[i] = 0.0f;
+        }
+
+        const float *stageReal = twiddleReal_.data();
+        const float *stageImag = twiddleImag_.data();
+        for (size_t half = 1; half < size_; half *= 2) {
+            for (size_t start = 0; start < size_; start += 2 * half) {
+                float *__restrict re0 = re + start;
+                float *__restrict im0 = im + start;
+                float *__restrict re1 = re + start + half;
+                float *__restrict im1 = im + start + half;
+                for (size_t j = 0; j < half; ++j) {
+                    float tr = re1[j] * stageReal[j] - im1[j] * stageImag[j];
+                    float ti = re1[j] * stageImag[j] + im1[j] * stageReal[j];
+                    re1[j] = re0[j] - tr;
+                    im1[j] = im0[j] - ti;
+                    re0[j] += tr;
+                    im0[j] += ti;
+                }
+            }
+            stageReal += half;
+            stageImag += half;
+        }
+
+        for (size_t k = 0; k <= size_ / 2; ++k) {
+            power[k] = re[k] * re[k] + im[k] * im[k];
+        }
+    }
+
+private:
+    size_t size_;
+    vector<size_t> bitReverse_;
+    vector<float> window_;
+    vector<float> twiddleReal_;
+    vector<float> twiddleImag_;
+    vector<float> real_;
+    vector<float> imag_;
+};
+
+// Acoustic fingerprint parameters (Haitsma-Kalker style sub-fingerprints)
+const int kFingerprintSampleRate = 5512;
+const size_t kFingerprintFrameSize = 2048;
+const size_t kFingerprintHopSize = 256;
+const int kFingerprintBands = 33;
+const double kFingerprintMinFrequency = 300.0;
+const double kFingerprintMaxFrequency = 2000.0;
+
+/**
+ * Function to compute the acoustic fingerprint of decoded audio
+ * 
+ * The audio is split into overlapping frames; each frame yields one 32-bit
+ * sub-fingerprint whose bits record whether the energy difference between adjacent
+ * logarithmic frequency bands rose or fell relative to the previous frame. These bits
+ * survive re-encoding, resampling and moderate noise, unlike a byte-level hash.
+ * 
+ * @param samples Mono samples at kFingerprintSampleRate
+ * @return One sub-fingerprint per frame
+ */
+vector<uint32_t> computeAudioFingerprint(const vector<float> &samples) {
+    vector<uint32_t> fingerprint;
+    if (samples.size() < kFingerprintFrameSize) {
+        return fingerprint;
+    }
+
+    PowerSpectrumFft fft(kFingerprintFrameSize);
+    vector<float> power(kFingerprintFrameSize / 2 + 1);
+
+    // Spectrum bin boundaries of the logarithmically spaced bands
+    vector<size_t> bandEdges(kFingerprintBands + 1);
+    double binWidth = static_cast<double>(kFingerprintSampleRate) / kFingerprintFrameSize;
+    for (int b = 0; b <= kFingerprintBands; ++b) {
+        double frequency = kFingerprintMinFrequency
+            * pow(kFingerprintMaxFrequency / kFingerprintMinFrequency, static_cast<double>(b) / kFingerprintBands);
+        bandEdges[b] = static_cast<size_t>(frequency / binWidth);
+    }
+
+    size_t frameCount = (samples.size() - kFingerprintFrameSize) / kFingerprintHopSize + 1;
+    fingerprint.reserve(frameCount);
+    vector<float> energy(kFingerprintBands), previousEnergy(kFingerprintBands);
+    for (size_t frame = 0; frame < frameCount; ++frame) {
+        fft.powerSpectrum(samples.data() + frame * kFingerprintHopSize, power.data());
+        for (int b = 0; b < kFingerprintBands; ++b) {
+            float sum = 0.0f;
+            for (size_t k = bandEdges[b]; k < max(bandEdges[b + 1], bandEdges[b] + 1); ++k) {
+                sum += power[k];
+            }
+            energy[b] = sum;
+        }
+        if (frame > 0) {
+            uint32_t bits = 0;
+            for (int b = 0; b < kFingerprintBands - 1; ++b) {
+                float difference = (energy[b] - energy[b + 1]) - (previousEnergy[b] - previousEnergy[b + 1]);
+                bits = (bits << 1) | (difference > 0.0f ? 1u : 0u);
+            }
+            fingerprint.push_back(bits);
+        }
+        swap(energy, previousEnergy);
+    }
+    return fingerprint;
+}
+
+/**
+ * Index of the acoustic fingerprints of previously processed recordings
+ * 
+ * Each entry stores the fingerprint of a recording together with what the pipeline
+ * produced for it (transcript and Notion page ID), so that a near-duplicate recording
+ * can reuse them instead of being transcribed and uploaded again.
+ * 
+ * Entries are appended to a record file (cache/fingerprints.index by default, set
+ * VR_FINGERPRINT_INDEX to move it or to "off" to disable deduplication). When loaded,
+ * every fourth sub-fingerprint is put into a hash table; candidate matches are found by
+ * looking up the sub-fingerprints of a new recording and voting on their time offset,
+ * then confirmed by the bit error rate over the overlapping frames.
+ */
+class FingerprintIndex {
+public:
+    struct Entry {
+        string audioPath;
+        string notionPageId;
+        string transcript;
+        vector<uint32_t> fingerprint;
+    };
+
+    struct Match {
+        const Entry *entry;
+        double bitErrorRate;
+    };
+
+    // Bit error rate below which two overlapping fingerprints are considered the same audio
+    static constexpr double kMatchThreshold = 0.35;
+    // Minimum overlap, as a fraction of the longer recording, so that a clip of a longer
+    // recording (or a recording of which the clip is a part) is not taken for the same audio
+    static constexpr double kMinimumOverlap = 0.8;
+    static const size_t kIndexStride = 4;
+    // Alignments verified by their bit error rate, taken by number of votes
+    static const size_t kMaxCandidates = 16;
+
+    static FingerprintIndex &instance() {
+        static FingerprintIndex index;
+        return index;
+    }
+
+    bool enabled() const {
+        return !path_.empty();
+    }
+
+    /**
+     * Function to find a previously processed recording with the same audio
+     * 
+     * @param fingerprint Fingerprint of the new recording
+     * @return The best match, or a match with a null entry if there is none
+     */
+    Match findNearDuplicate(const vector<uint32_t> &fingerprint) const {
+        Match best{nullptr, 1.0};
+        if (fingerprint.size() < 64) {
+            return best;
+        }
+        // Vote for (entry, offset) pairs whose sub-fingerprints match exactly or differ in one bit.
+        // Each pair is packed into one key: the entry index above, the offset (as 32 bits) below
+        unordered_map<uint64_t, uint32_t> votes;
+        vector<pair<const Entry*, long>> candidates;
+        {
+            lock_guard<mutex> lock(mutex_);
+            for (size_t q = 0; q < fingerprint.size(); ++q) {
+                for (int flip = -1; flip < 32; ++flip) {
+                    uint32_t probe = flip < 0 ? fingerprint[q] : fingerprint[q] ^ (1u << flip);
+                    auto hits = postings_.find(probe);
+                    if (hits == postings_.end()) {
+                        continue;
+                    }
+                    for (const auto &[entryIndex, frame] : hits->second) {
+                        long offset = static_cast<long>(frame) - static_cast<long>(q);
+                        ++votes[(static_cast<uint64_t>(entryIndex) << 32) | static_cast<uint32_t>(offset)];
+                    }
+                }
+            }
+
+            // Keep the most promising alignments; entries never move, so they are verified unlocked
+            vector<pair<uint32_t, uint64_t>> ranked;
+            for (const auto &[key, count] : votes) {
+                if (count >= 2) {
+                    ranked.push_back({count, key});
+                }
+            }
+            size_t kept = min<size_t>(ranked.size(), kMaxCandidates);
+            partial_sort(ranked.begin(), ranked.begin() + kept, ranked.end(), greater<>());
+            for (size_t index = 0; index < kept; ++index) {
+                uint64_t key = ranked[index].second;
+                candidates.push_back({&entries_[key >> 32], static_cast<int32_t>(static_cast<uint32_t>(key))});
+            }
+        }
+        for (const auto &[entry, offset] : candidates) {
+            double rate = bitErrorRate(fingerprint, entry->fingerprint, offset);
+            if (rate < kMatchThreshold && rate < best.bitErrorRate) {
+                best = {entry, rate};
+            }
+        }
+        return best;
+    }
+
+    // Add a processed recording to the index and persist it
+    void add(Entry entry) {
+        if (!enabled() || entry.fingerprint.empty()) {
+            return;
+        }
+        string record;
+        appendField(record, entry.audioPath);
+        appendField(record, entry.notionPageId);
+        appendField(record, entry.transcript);
+        appendField(record, string(reinterpret_cast<const char*>(entry.fingerprint.data()),
+                                   entry.fingerprint.size() * sizeof(uint32_t)));
+        lock_guard<mutex> lock(mutex_);
+        ofstream file(path_, ios::binary | ios::app);
+        file.write(record.data(), record.size());
+        if (!file) {
+            cerr << "Failed to update fingerprint index: " << path_ << endl;
+            return;
+        }
+        entries_.push_back(move(entry));
+        indexEntry(entries_.size() - 1);
+    }
+
+private:
+    FingerprintIndex() {
+        const char *configured = getenv("VR_FINGERPRINT_INDEX");
+        string path = configured && *configured ? configured : "cache/fingerprints.index";
+        if (path == "off") {
+            return;
+        }
+        path_ = path;
+        error_code ec;
+        std::filesystem::path parent = std::filesystem::path(path).parent_path();
+        if (!parent.empty()) {
+            std::filesystem::create_directories(parent, ec);
+        }
+        load();
+    }
+
+    static void appendField(string &record, const string &value) {
+        uint32_t length = value.size();
+        record.append(reinterpret_cast<const char*>(&length), sizeof(length));
+        record += value;
+    }
+
+    static bool readField(const char *&cursor, const char *end, string &value) {
+        uint32_t length;
+        if (end - cursor < static_cast<ptrdiff_t>(sizeof(length))) {
+            return false;
+        }
+        memcpy(&length, cursor, sizeof(length));
+        cursor += sizeof(length);
+        if (end - cursor < static_cast<ptrdiff_t>(length)) {
+            return false;
+        }
+        value.assign(cursor, length);
+        cursor += length;
+        return true;
+    }
+
+    void load() {
+        MappedFile mapped(path_);
+        if (!mapped.isOpen() || mapped.size() == 0) {
+            return;
+        }
+        const char *cursor = mapped.data();
+        const char *end = cursor + mapped.size();
+        while (cursor < end) {
+            Entry entry;
+            string frames;
+            if (!readField(cursor, end, entry.audioPath) || !readField(cursor, end, entry.notionPageId)
+                || !readField(cursor, end, entry.transcript) || !readField(cursor, end, frames)) {
+                break;  // Truncated trailing record
+            }
+            entry.fingerprint.resize(frames.size() / sizeof(uint32_t));
+            memcpy(entry.fingerprint.data(), frames.data(), entry.fingerprint.size() * sizeof(uint32_t));
+            entries_.push_back(move(entry));
+            indexEntry(entries_.size() - 1);
+        }
+    }
+
+    void indexEntry(size_t entryIndex) {
+        const vector<uint32_t> &fingerprint = entries_[entryIndex].fingerprint;
+        for (size_t frame = 0; frame < fingerprint.size(); frame += kIndexStride) {
+            // Silence produces constant sub-fingerprints that would match everything
+            if (fingerprint[frame] != 0 && fingerprint[frame] != 0xffffffffu) {
+                postings_[fingerprint[frame]].push_back({entryIndex, static_cast<uint32_t>(frame)});
+            }
+        }
+    }
+
+    // Fraction of differing bits where query frame q aligns with stored frame q + offset
+    static double bitErrorRate(const vector<uint32_t> &query, const vector<uint32_t> &stored, long offset) {
+        long first = max(0L, -offset);
+        long last = min(static_cast<long>(query.size()), static_cast<long>(stored.size()) - offset);
+        if (last <= first) {
+            return 1.0;
+        }
+        size_t overlap = last - first;
+        if (overlap < kMinimumOverlap * max(query.size(), stored.size())) {
+            return 1.0;
+        }
+        size_t differingBits = 0;
+        for (long q = first; q < last; ++q) {
+            differingBits += __builtin_popcount(query[q] ^ stored[q + offset]);
+        }
+        return static_cast<double>(differingBits) / (overlap * 32.0);
+    }
+
+    string path_;
+    // A deque keeps the entries returned by findNearDuplicate in place while other jobs add
+    deque<Entry> entries_;
+    unordered_map<uint32_t, vector<pair<size_t, uint32_t>>> postings_;
+    mutable std::mutex mutex_;
+};
+
+/**
+ * Function to escape JSON special characters in a string
+ * 
+ * This function escapes special characters in a string to make it safe for inclusion in JSON.
+ * It handles characters like quotes, backslashes, and control characters.
+ * 
+ * @param input The string to escape
+ * @return The escaped string
+ */
+string escapeJsonString(const string &input) {
+    ostringstream escaped;
+    for (char c : input) {
+        switch (c) {
+            case '"': escaped << "\\\""; break;
+            case '\\': escaped << "\\\\"; break;
+            case '\b': escaped << "\\b"; break;
+            case '\f': escaped << "\\f"; break;
+            case '\n': escaped << "\\n"; break;
+            case '\r': escaped << "\\r"; break;
+            case '\t': escaped << "\\t"; break;
+            default:
+                if ('\x00' <= c && c <= '\x1f') {
+                    escaped << "\\u" << hex << setw(4) << setfill('0') << (int)c;
+                } else {
+                    escaped << c;
+                }
+        }
+    }
+    return escaped.str();
+}
+
+// Model used to categorize transcriptions
+const string kCategorizationModel = "gpt-4o";
+
+// Version of the categorization prompt; bump it whenever the prompt changes so cached results are not reused
+const int kCategorizationPromptVersion = 2;
+
+/**
+ * Function to estimate the number of tokens in a text
+ * 
+ * English text averages about four bytes per token, which is accurate enough to
+ * route requests and estimate their cost without shipping a tokenizer.
+ * 
+ * @param text The text
+ * @return The estimated token count
+ */
+size_t estimateTokenCount(const string &text) {
+    return (text.size() + 3) / 4;
+}
+
+/**
+ * Routing of categorization requests between models
+ * 
+ * Routes are an ordered list from the fastest and cheapest model to the strongest,
+ * each taking transcripts up to a token limit (VR_MODEL_ROUTES, default
+ * "gpt-4o-mini:1500,gpt-4o"; the last route has no limit). The routed model is then
+ * checked against the optional budgets VR_LATENCY_BUDGET_MS and VR_COST_BUDGET_USD,
+ * and replaced by the next cheaper route while it does not fit. A route named "local"
+ * (e.g. "local:800,gpt-4o-mini:1500,gpt-4o") goes to the LocalCategorizationBackend.
+ * Model names may contain colons (e.g. fine-tuned "ft:gpt-4o-mini:org::id"); only
+ * digits after the last colon are read as a limit.
+ * 
+ * Latency is predicted from the observed latencies of each model, fitted linearly
+ * against prompt size. Every successful request is appended to the latency log
+ * (VR_MODEL_LATENCY_LOG, default cache/model_latency.tsv, "off" to disable) as a
+ * "model, prompt tokens, milliseconds" line.
+ */
+class ModelRouter {
+public:
+    struct Route {
+        string model;
+        size_t maxTokens;
+    };
+
+    struct LatencyStats {
+        size_t count;
+        double p50Ms;
+        double p95Ms;
+        double baseMs;
+        double msPerThousandTokens;
+    };
+
+    // Observations per model used for prediction
+    static const size_t kLatencyWindow = 256;
+    // Observations needed before a model's latency is predicted
+    static const size_t kMinimumObservations = 5;
+    // Completion length assumed when estimating cost
+    static const size_t kExpectedCompletionTokens = 600;
+
+    static ModelRouter &instance() {
+        static ModelRouter router;
+        return router;
+    }
+
+    /**
+     * Function to choose the model for a transcript
+     * 
+     * @param transcription The transcription text
+     * @return Name of the model to use
+     */
+    string choose(const string &transcription) const {
+        size_t tokens = estimateTokenCount(transcription);
+        size_t route = 0;
+        while (route + 1 < routes_.size() && tokens > routes_[route].maxTokens) {
+            ++route;
+        }
+        // Step down to cheaper, faster models while the budgets are exceeded
+        while (route > 0 && !withinBudget(routes_[route].model, tokens)) {
+            --route;
+        }
+        return routes_[route].model;
+    }
+
+    /**
+     * Function to record the latency of a successful request
+     * 
+     * @param model The model that answered
+     * @param promptTokens Estimated tokens of the transcription
+     * @param milliseconds Request latency
+     */
+    void recordLatency(const string &model, size_t promptTokens, double milliseconds) {
+        lock_guard<mutex> lock(mutex_);
+        remember(model, promptTokens, milliseconds);
+        if (!logPath_.empty()) {
+            ofstream log(logPath_, ios::app);
+            log << model << '\t' << promptTokens << '\t' << fixed << setprecision(0) << milliseconds << '\n';
+        }
+    }
+
+    /**
+     * Function to summarize the observed latencies of a model
+     * 
+     * @param model The model
+     * @param stats Receives the percentiles and the linear latency fit
+     * @return false if the model has no observations
+     */
+    bool latencyStats(const string &model, LatencyStats &stats) const {
+        lock_guard<mutex> lock(mutex_);
+        auto found = observations_.find(model);
+        if (found == observations_.end() || found->second.empty()) {
+            return false;
+        }
+        const deque<pair<size_t, double>> &samples = found->second;
+        vector<double> latencies;
+        for (const auto &sample : samples) {
+            latencies.push_back(sample.second);
+        }
+        sort(latencies.begin(), latencies.end());
+        stats.count = samples.size();
+        stats.p50Ms = latencies[latencies.size() / 2];
+        stats.p95Ms = latencies[min(latencies.size() - 1, latencies.size() * 95 / 100)];
+        fitLatency(samples, stats.baseMs, stats.msPerThousandTokens);
+        return true;
+    }
+
+    /**
+     * Function to predict a latency quantile of a model for a prompt size
+     * 
+     * The linear fit gives the typical latency at the prompt size; the quantile of the
+     * residuals around the fit is added to it, so a long transcript is not judged
+     * slow merely for being long.
+     * 
+     * @param model The model
+     * @param promptTokens Estimated tokens of the transcription
+     * @param quantile The quantile, e.g. 0.95
+     * @param milliseconds Receives the predicted latency
+     * @return false if the model has fewer than kMinimumObservations observations
+     */
+    bool predictLatency(const string &model, size_t promptTokens, double quantile, double &milliseconds) const {
+        lock_guard<mutex> lock(mutex_);
+        auto found = observations_.find(model);
+        if (found == observations_.end() || found->second.size() < kMinimumObservations) {
+            return false;
+        }
+        double baseMs, msPerThousandTokens;
+        fitLatency(found->second, baseMs, msPerThousandTokens);
+        vector<double> residuals;
+        for (const auto &[tokens, observed] : found->second) {
+            residuals.push_back(observed - (baseMs + msPerThousandTokens * tokens / 1000.0));
+        }
+        sort(residuals.begin(), residuals.end());
+        size_t rank = min(residuals.size() - 1, static_cast<size_t>(residuals.size() * quantile));
+        milliseconds = max(0.0, baseMs + msPerThousandTokens * promptTokens / 1000.0 + residuals[rank]);
+        return true;
+    }
+
+    const vector<Route> &routes() const {
+        return routes_;
+    }
+
+    vector<string> observedModels() const {
+        lock_guard<mutex> lock(mutex_);
+        vector<string> models;
+        for (const auto &entry : observations_) {
+            models.push_back(entry.first);
+        }
+        return models;
+    }
+
+private:
+    // Prices in USD per million tokens (input, output)
+    struct ModelPrice {
+        const char *model;
+        double input;
+        double output;
+    };
+
+    static constexpr ModelPrice kModelPrices[] = {
+        {"gpt-4o-mini", 0.15, 0.60},
+        {"gpt-4o", 2.50, 10.00},
+        {"gpt-4.1-nano", 0.10, 0.40},
+        {"gpt-4.1-mini", 0.40, 1.60},
+        {"gpt-4.1", 2.00, 8.00}
+    };
+
+    ModelRouter() {
+        const char *configured = getenv("VR_MODEL_ROUTES");
+        string routes = configured && *configured ? configured : "gpt-4o-mini:1500," + kCategorizationModel;
+        stringstream list(routes);
+        string entry;
+        while (getline(list, entry, ',')) {
+            size_t colon = entry.rfind(':');
+            if (entry.empty()) {
+                continue;
+            }
+            // A model name may itself contain colons (e.g. "llama3:8b"); only digits make a limit
+            bool hasLimit = colon != string::npos && colon + 1 < entry.size()
+                            && all_of(entry.begin() + colon + 1, entry.end(),
+                                      [](unsigned char c) { return isdigit(c) != 0; });
+            if (!hasLimit) {
+                routes_.push_back({entry, SIZE_MAX});
+            } else {
+                routes_.push_back({entry.substr(0, colon), strtoull(entry.c_str() + colon + 1, nullptr, 10)});
+            }
+        }
+        if (routes_.empty()) {
+            routes_.push_back({kCategorizationModel, SIZE_MAX});
+        }
+
+        const char *latencyBudget = getenv("VR_LATENCY_BUDGET_MS");
+        latencyBudgetMs_ = latencyBudget ? strtod(latencyBudget, nullptr) : 0;
+        const char *costBudget = getenv("VR_COST_BUDGET_USD");
+        costBudgetUsd_ = costBudget ? strtod(costBudget, nullptr) : 0;
+
+        const char *log = getenv("VR_MODEL_LATENCY_LOG");
+        string logPath = log && *log ? log : "cache/model_latency.tsv";
+        if (logPath != "off") {
+            logPath_ = logPath;
+            error_code ec;
+            std::filesystem::path parent = std::filesystem::path(logPath).parent_path();
+            if (!parent.empty()) {
+                std::filesystem::create_directories(parent, ec);
+            }
+            loadLog();
+        }
+    }
+
+    void loadLog() {
+        ifstream log(logPath_);
+        string model;
+        size_t tokens;
+        double milliseconds;
+        while (log >> model >> tokens >> milliseconds) {
+            remember(model, tokens, milliseconds);
+        }
+    }
+
+    void remember(const string &model, size_t tokens, double milliseconds) {
+        deque<pair<size_t, double>> &samples = observations_[model];
+        samples.push_back({tokens, milliseconds});
+        if (samples.size() > kLatencyWindow) {
+            samples.pop_front();
+        }
+    }
+
+    // Least-squares fit of latency = base + slope * tokens / 1000
+    static void fitLatency(const deque<pair<size_t, double>> &samples, double &baseMs, double &msPerThousandTokens) {
+        double n = samples.size(), sumX = 0, sumY = 0, sumXX = 0, sumXY = 0;
+        for (const auto &[tokens, milliseconds] : samples) {
+            double x = tokens / 1000.0;
+            sumX += x;
+            sumY += milliseconds;
+            sumXX += x * x;
+            sumXY += x * milliseconds;
+        }
+        double denominator = n * sumXX - sumX * sumX;
+        msPerThousandTokens = denominator > 1e-9 ? max(0.0, (n * sumXY - sumX * sumY) / denominator) : 0;
+        baseMs = (sumY - msPerThousandTokens * sumX) / n;
+    }
+
+    bool withinBudget(const string &model, size_t tokens) const {
+        if (costBudgetUsd_ > 0) {
+            for (const auto &price : kModelPrices) {
+                if (model == price.model
+                    && (tokens * price.input + kExpectedCompletionTokens * price.output) / 1e6 > costBudgetUsd_) {
+                    return false;
+                }
+            }
+        }
+        if (latencyBudgetMs_ > 0) {
+            lock_guard<mutex> lock(mutex_);
+            auto found = observations_.find(model);
+            if (found != observations_.end() && found->second.size() >= kMinimumObservations) {
+                double baseMs, msPerThousandTokens;
+                fitLatency(found->second, baseMs, msPerThousandTokens);
+                if (baseMs + msPerThousandTokens * tokens / 1000.0 > latencyBudgetMs_) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    vector<Route> routes_;
+    double latencyBudgetMs_ = 0;
+    double costBudgetUsd_ = 0;
+    string logPath_;
+    mutable std::mutex mutex_;
+    map<string, deque<pair<size_t, double>>> observations_;
+};
+
+/**
+ * Function to print the observed categorization latency of every model
+ * 
+ * @return true if any latency was recorded
+ */
+bool printModelStats() {
+    ModelRouter &router = ModelRouter::instance();
+    cout << "Routes:";
+    for (const auto &route : router.routes()) {
+        cout << " " << route.model;
+        if (route.maxTokens != SIZE_MAX) {
+            cout << " (up to " << route.maxTokens << " tokens)";
+        }
+    }
+    cout << endl;
+
+    vector<string> models = router.observedModels();
+    if (models.empty()) {
+        cout << "No latencies recorded yet" << endl;
+        return false;
+    }
+    cout << left << setw(20) << "Model" << right << setw(10) << "Requests" << setw(12) << "p50 (ms)"
+         << setw(12) << "p95 (ms)" << setw(12) << "Base (ms)" << setw(16) << "ms/1k tokens" << endl;
+    for (const string &model : models) {
+        ModelRouter::LatencyStats stats;
+        if (router.latencyStats(model, stats)) {
+            cout << left << setw(20) << model << right << setw(10) << stats.count << fixed << setprecision(0)
+                 << setw(12) << stats.p50Ms << setw(12) << stats.p95Ms << setw(12) << stats.baseMs
+                 << setw(16) << stats.msPerThousandTokens << endl;
+        }
+    }
+    return true;
+}
+
+/**
+ * Fields of a categorized result, in the shape sendToNotion and the LaTeX report expect
+ */
+enum class CategorizationFieldType { Text, TextList, Number };
+
+struct CategorizationField {
+    const char *name;
+    CategorizationFieldType type;
+    // A reply without this field is unusable, not repairable
+    bool required = false;
+};
+
+static const CategorizationField kCategorizationFields[] = {
+    {"AI_Title", CategorizationFieldType::Text, true},
+    {"Summary", CategorizationFieldType::Text, true},
+    {"Main Points", CategorizationFieldType::TextList},
+    {"Action Items", CategorizationFieldType::TextList},
+    {"Follow-up Questions", CategorizationFieldType::TextList},
+    {"Stories", CategorizationFieldType::TextList},
+    {"References", CategorizationFieldType::TextList},
+    {"Arguments", CategorizationFieldType::TextList},
+    {"Sentiment", CategorizationFieldType::Text},
+    {"Type", CategorizationFieldType::Text},
+    {"Duration", CategorizationFieldType::Text},
+    {"Duration (Seconds)", CategorizationFieldType::Number},
+    {"AI Cost", CategorizationFieldType::Number},
+    {"Icon", CategorizationFieldType::Text}
+};
+
+/**
+ * JSON schema of the categorized result, compiled once from kCategorizationFields
+ * 
+ * Provides the strict json_schema response format sent with every chat request, and
+ * a checker that validates a parsed reply in a single pass over its members. Values
+ * of the wrong type are coerced (a list where text was expected is joined, text
+ * where a list was expected becomes one item, numbers are read from text such as
+ * "$0.02"), unknown members are dropped and missing ones are added empty, so a
+ * nearly-correct reply is repaired locally instead of being discarded. A reply
+ * without a required field (the title and summary) cannot be repaired: padding it
+ * would pass an empty or truncated reply off as a result.
+ */
+class CategorizationSchema {
+public:
+    static const CategorizationSchema &instance() {
+        static const CategorizationSchema schema;
+        return schema;
+    }
+
+    // The "response_format" member of a chat completions request
+    const string &responseFormat() const {
+        return responseFormat_;
+    }
+
+    // Whether a field holds nothing, as a field added by validate() does
+    static bool isEmpty(const json &value) {
+        return value.is_null() || (value.is_string() && value.get_ref<const string &>().empty())
+               || (value.is_array() && value.empty()) || (value.is_number() && value.get<double>() == 0);
+    }
+
+    /**
+     * Function to validate a categorized result and repair it in place
+     * 
+     * @param data The parsed reply; must be a JSON object
+     * @param repairs Receives a description of every repair made
+     * @return true if data is an object with every required field (and now matches the
+     *         schema), false otherwise
+     */
+    bool validate(json &data, vector<string> &repairs) const {
+        if (!data.is_object()) {
+            return false;
+        }
+        vector<bool> seen(kFieldCount, false);
+        vector<string> unknown;
+        for (auto &[key, value] : data.items()) {
+            auto found = index_.find(key);
+            if (found == index_.end()) {
+                unknown.push_back(key);
+                continue;
+            }
+            seen[found->second] = true;
+            coerce(kCategorizationFields[found->second], value, repairs);
+        }
+        for (const string &key : unknown) {
+            data.erase(key);
+            repairs.push_back("dropped unknown field \"" + key + "\"");
+        }
+        for (size_t field = 0; field < kFieldCount; ++field) {
+            if (kCategorizationFields[field].required && (!seen[field] || isEmpty(data[kCategorizationFields[field].name]))) {
+                return false;
+            }
+            if (!seen[field]) {
+                data[kCategorizationFields[field].name] = emptyValue(kCategorizationFields[field].type);
+                repairs.push_back(string("added missing field \"") + kCategorizationFields[field].name + "\"");
+            }
+        }
+        return true;
+    }
+
+private:
+    static const size_t kFieldCount = sizeof(kCategorizationFields) / sizeof(kCategorizationFields[0]);
+
+    CategorizationSchema() {
+        json properties = json::object();
+        json required = json::array();
+        for (size_t field = 0; field < kFieldCount; ++field) {
+            const CategorizationField &definition = kCategorizationFields[field];
+            index_[definition.name] = field;
+            required.push_back(definition.name);
+            switch (definition.type) {
+                case CategorizationFieldType::Text:
+                    properties[definition.name] = {{"type", "string"}};
+                    break;
+                case CategorizationFieldType::TextList:
+                    properties[definition.name] = {{"type", "array"}, {"items", {{"type", "string"}}}};
+                    break;
+                case CategorizationFieldType::Number:
+                    properties[definition.name] = {{"type", "number"}};
+                    break;
+            }
+        }
+        json format = {
+            {"type", "json_schema"},
+            {"json_schema", {
+                {"name", "voice_note"},
+                {"strict", true},
+                {"schema", {
+                    {"type", "object"},
+                    {"properties", properties},
+                    {"required", required},
+                    {"additionalProperties", false}
+                }}
+            }}
+        };
+        responseFormat_ = format.dump();
+    }
+
+    static json emptyValue(CategorizationFieldType type) {
+        switch (type) {
+            case CategorizationFieldType::TextList: return json::array();
+            case CategorizationFieldType::Number: return 0;
+            default: return "";
+        }
+    }
+
+    static string asText(const json &value) {
+        return value.is_string() ? value.get<string>() : value.is_null() ? "" : value.dump();
+    }
+
+    static void coerce(const CategorizationField &field, json &value, vector<string> &repairs) {
+        string name = field.name;
+        switch (field.type) {
+            case CategorizationFieldType::Text:
+                if (!value.is_string()) {
+                    string text;
+                    if (value.is_array()) {
+                        for (const auto &item : value) {
+                            text += (text.empty() ? "" : ", ") + asText(item);
+                        }
+                    } else {
+                        text = asText(value);
+                    }
+                    value = text;
+                    repairs.push_back("converted \"" + name + "\" to text");
+                }
+                break;
+            case CategorizationFieldType::TextList:
+                if (value.is_array()) {
+                    for (auto &item : value) {
+                        if (!item.is_string()) {
+                            item = asText(item);
+                            repairs.push_back("converted an item of \"" + name + "\" to text");
+                        }
+                    }
+                } else {
+                    json items = json::array();
+                    if (value.is_object()) {
+                        for (const auto &[key, item] : value.items()) {
+                            items.push_back(key + ": " + asText(item));
+                        }
+                    } else if (!value.is_null() && !asText(value).empty()) {
+                        items.push_back(asText(value));
+                    }
+                    value = items;
+                    repairs.push_back("converted \"" + name + "\" to a list");
+                }
+                break;
+            case CategorizationFieldType::Number:
+                if (!value.is_number()) {
+                    string text = asText(value);
+                    size_t start = text.find_first_of("0123456789.-");
+                    char *end = nullptr;
+                    double number = start == string::npos ? 0 : strtod(text.c_str() + start, &end);
+                    value = std::isfinite(number) ? number : 0.0;
+                    repairs.push_back("converted \"" + name + "\" to a number");
+                }
+                break;
+        }
+    }
+
+    unordered_map<string, size_t> index_;
+    string responseFormat_;
+};
+
+/**
+ * Function to repair common defects of JSON text produced by a model
+ * 
+ * Takes the outermost object (dropping markdown code fences and surrounding prose),
+ * removes trailing commas, and closes strings, arrays and objects left open by a
+ * truncated reply.
+ * 
+ * @param text The model's reply
+ * @return The repaired text (possibly still invalid)
+ */
+string repairJsonText(const string &text) {
+    size_t begin = text.find('{');
+    if (begin == string::npos) {
+        return text;
+    }
+    size_t end = text.rfind('}');
+    // Keep everything after the opening brace if the closing one is missing (truncated reply)
+    string body = end != string::npos && end > begin ? text.substr(begin, end - begin + 1) : text.substr(begin);
+
+    string repaired;
+    repaired.reserve(body.size() + 8);
+    vector<char> closers;
+    bool inString = false;
+    bool escaped = false;
+    for (char c : body) {
+        if (inString) {
+            repaired += c;
+            if (escaped) {
+                escaped = false;
+            } else if (c == '\\') {
+                escaped = true;
+            } else if (c == '"') {
+                inString = false;
+            }
+            continue;
+        }
+        if (c == '}' || c == ']') {
+            // Drop a trailing comma before the closing bracket
+            size_t last = repaired.find_last_not_of(" \t\r\n");
+            if (last != string::npos && repaired[last] == ',') {
+                repaired.erase(last, 1);
+            }
+            if (!closers.empty()) {
+                closers.pop_back();
+            }
+        } else if (c == '{') {
+            closers.push_back('}');
+        } else if (c == '[') {
+            closers.push_back(']');
+        } else if (c == '"') {
+            inString = true;
+        }
+        repaired += c;
+    }
+
+    if (inString) {
+        if (escaped) {
+            repaired.pop_back();
+        }
+        repaired += '"';
+    }
+    // A truncated reply may end after a comma or a key; drop the dangling part
+    size_t last = repaired.find_last_not_of(" \t\r\n");
+    if (last != string::npos && repaired[last] == ',') {
+        repaired.erase(last);
+    } else if (last != string::npos && repaired[last] == ':') {
+        repaired += " null";
+    }
+    while (!closers.empty()) {
+        repaired += closers.back();
+        closers.pop_back();
+    }
+    return repaired;
+}
+
+/**
+ * Function to build the chat completions request that categorizes a transcription
+ * 
+ * @param transcription The transcription text to analyze
+ * @param model The chat model to use
+ * @param extraFields Further members of the request, each followed by a comma
+ * @return The JSON request body
+ */
+string categorizationRequestBody(const string &transcription, const string &model, const string &extraFields = "") {
+    // Escape transcription text for JSON safety
+    string escapedTranscription = escapeJsonString(transcription);
+
+    // Define the summary options from the Notion Voice Notes configuration
+    vector<string> summaryOptions = {
+        "Summary",
+        "Main Points",
+        "Action Items",
+        "References",
+        "Follow-up Questions",
+        "Stories",
+        "Arguments",
+        "Sentiment"
+    };
+
+    // Build the summary options string
+    string summaryOptionsStr = "";
+    for (size_t i = 0; i < summaryOptions.size(); ++i) {
+        summaryOptionsStr += summaryOptions[i];
+        if (i < summaryOptions.size() - 1) {
+            summaryOptionsStr += ", ";
+        }
+    }
+
+    // Build the JSON payload using a raw string literal for clarity
+    return R"({
+            "model": ")" + model + R"(",)" + extraFields + R"(
+            "messages": [
+                {
+                    "role": "system",
+                    "content": "You are an assistant that analyzes voice recordings and outputs categorized sections in JSON format for Notion database integration."
+                },
+                {
+                    "role": "user",
+                    "content": "Analyze the following transcription and categorize it into these sections: )" + summaryOptionsStr + R"(. Generate an AI title for the note. For Type, suggest a category like 'AI Transcription', 'Meeting Notes', etc. For Duration, provide a time format like '00:07:26'. Calculate the Duration (Seconds) as a number. Include an AI Cost estimate (a small dollar amount). Also include an Icon field with the value '🤖'. Format all lists as arrays. Provide the output in clean JSON format with no markdown formatting.\n\nTranscription: )" + escapedTranscription + R"("
+                }
+            ],
+            "response_format": )" + CategorizationSchema::instance().responseFormat() + R"(
+        })";
+}
+
+/**
+ * Function to communicate with the OpenAI Chat Completions API for categorizing transcription
+ * 
+ * This function sends the transcription text to an OpenAI chat model for analysis.
+ * It requests categorization into various sections based on the Notion Voice Notes structure.
+ * 
+ * @param transcription The transcription text to analyze
+ * @param apiKey OpenAI API key for authentication
+ * @param model The chat model to use (see ModelRouter)
+ * @return The API response containing the categorized content
+ */
+string categorizeWithOpenAI(const string& transcription, const string& apiKey, const string &model = kCategorizationModel) {
+    CURL* curl;
+    CURLcode res;
+    string responseString;
+    curl = curl_easy_init();
+    if (curl) {
+        string data = categorizationRequestBody(transcription, model);
+
+        // Set up the headers
+        struct curl_slist* headers = nullptr;
+        headers = curl_slist_append(headers, ("Authorization: Bearer " + apiKey).c_str());
+        headers = curl_slist_append(headers, "Content-Type: application/json");
+
+        // Set the API endpoint for chat completions
+        string url = openAiBaseUrl() + "/v1/chat/completions";
+        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+        curl_easy_setopt(curl, CURLOPT_POST, 1L);
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, data.c_str());
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &responseString);
+
+        // Perform the request, hedging it once it runs past the model's p95 for this prompt size
+        double hedgeAfterMs = 0;
+        if (RequestHedger::instance().enabled()) {
+            ModelRouter::instance().predictLatency(model, estimateTokenCount(transcription), 0.95, hedgeAfterMs);
+        }
+        auto startTime = chrono::steady_clock::now();
+        long httpStatus = 0;
+        res = performHedgedHttpRequest(curl, "POST", url, data, responseString, &httpStatus, hedgeAfterMs);
+        if (res != CURLE_OK) {
+            cerr << "CURL error (chat completions): " << curl_easy_strerror(res) << endl;
+        } else if (httpStatus == 200 && HttpFixtures::instance().mode() != HttpFixtures::Mode::Replay) {
+            // Feed the router's latency model (replayed timings are not real observations)
+            double milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+            ModelRouter::instance().recordLatency(model, estimateTokenCount(transcription), milliseconds);
+        }
+
+        // Clean up
+        curl_slist_free_all(headers);
+        curl_easy_cleanup(curl);
+    }
+    return responseString;
+}
+
+/**
+ * Function to compute the categorization cache key of a transcript
+ * 
+ * The transcript is normalized first (ASCII case folded, whitespace runs collapsed,
+ * leading and trailing whitespace dropped), so re-encodes of a recording that produce
+ * trivially different transcripts share a key. The prompt version and model are part
+ * of the key, so changing either never returns stale results.
+ * 
+ * @param transcription The transcription text
+ * @param model The categorization model
+ * @return The cache key
+ */
+uint64_t categorizationCacheKey(const string &transcription, const string &model) {
+    string normalized;
+    normalized.reserve(transcription.size());
+    bool pendingSpace = false;
+    for (char c : transcription) {
+        if (isspace(static_cast<unsigned char>(c))) {
+            pendingSpace = !normalized.empty();
+            continue;
+        }
+        if (pendingSpace) {
+            normalized.push_back(' ');
+            pendingSpace = false;
+        }
+        normalized.push_back(static_cast<char>(tolower(static_cast<unsigned char>(c))));
+    }
+
+    string context = to_string(kCategorizationPromptVersion) + "\n" + model + "\n";
+    uint64_t hash = fnv1aHash(context.data(), context.size());
+    return fnv1aHash(normalized.data(), normalized.size(), hash);
+}
+
+/**
+ * Cache of categorization results keyed by normalized transcript
+ * 
+ * Results are kept in an append-only file of records (u64 key, u32 length, JSON text)
+ * whose offsets are indexed in memory when the cache is opened. Recently used results
+ * are additionally held in an in-memory LRU, so repeated lookups do not touch the disk.
+ * 
+ * The file defaults to cache/categorization.cache and can be moved with the
+ * VR_CATEGORIZATION_CACHE environment variable; setting it to "off" disables the cache.
+ */
+class CategorizationCache {
+public:
+    static const size_t kMemoryEntries = 256;
+
+    static CategorizationCache &instance() {
+        static CategorizationCache cache;
+        return cache;
+    }
+
+    /**
+     * Function to look up a cached categorization
+     * 
+     * @param key Key from categorizationCacheKey
+     * @param result Receives the cached categorized JSON
+     * @return true on a cache hit
+     */
+    bool lookup(uint64_t key, json &result) {
+        string text;
+        {
+            lock_guard<mutex> lock(mutex_);
+            auto cached = lruIndex_.find(key);
+            if (cached != lruIndex_.end()) {
+                lru_.splice(lru_.begin(), lru_, cached->second);
+                text = cached->second->second;
+            } else {
+                auto stored = diskIndex_.find(key);
+                if (stored == diskIndex_.end() || !readRecord(stored->second, text)) {
+                    return false;
+                }
+                remember(key, text);
+            }
+        }
+        try {
+            result = json::parse(text);
+            return true;
+        } catch (const exception &e) {
+            cerr << "Ignoring corrupt categorization cache entry: " << e.what() << endl;
+            return false;
+        }
+    }
+
+    /**
+     * Function to store a categorization result
+     * 
+     * @param key Key from categorizationCacheKey
+     * @param result The categorized JSON
+     */
+    void store(uint64_t key, const json &result) {
+        string text = result.dump();
+        lock_guard<mutex> lock(mutex_);
+        if (!file_ || diskIndex_.count(key)) {
+            return;
+        }
+        char header[12];
+        uint32_t length = text.size();
+        memcpy(header, &key, sizeof(key));
+        memcpy(header + sizeof(key), &length, sizeof(length));
+
+        fseek(file_, 0, SEEK_END);
+        long offset = ftell(file_);
+        if (fwrite(header, 1, sizeof(header), file_) != sizeof(header)
+            || fwrite(text.data(), 1, text.size(), file_) != text.size() || fflush(file_) != 0) {
+            cerr << "Failed to write categorization cache entry" << endl;
+            return;
+        }
+        diskIndex_[key] = {static_cast<uint64_t>(offset) + sizeof(header), length};
+        remember(key, text);
+    }
+
+private:
+    struct Location {
+        uint64_t offset;
+        uint32_t length;
+    };
+
+    CategorizationCache() {
+        const char *configured = getenv("VR_CATEGORIZATION_CACHE");
+        string path = configured && *configured ? configured : "cache/categorization.cache";
+        if (path == "off") {
+            return;
+        }
+        error_code ec;
+        std::filesystem::path parent = std::filesystem::path(path).parent_path();
+        if (!parent.empty()) {
+            std::filesystem::create_directories(parent, ec);
+        }
+        file_ = fopen(path.c_str(), "a+b");
+        if (!file_) {
+            cerr << "Failed to open categorization cache: " << path << endl;
+            return;
+        }
+        loadIndex();
+    }
+
+    ~CategorizationCache() {
+        if (file_) {
+            fclose(file_);
+        }
+    }
+
+    // Scan the record headers; a truncated trailing record (e.g. from a crash) is ignored
+    void loadIndex() {
+        fseek(file_, 0, SEEK_END);
+        uint64_t size = ftell(file_);
+        uint64_t offset = 0;
+        char header[12];
+        while (offset + sizeof(header) <= size) {
+            fseek(file_, offset, SEEK_SET);
+            if (fread(header, 1, sizeof(header), file_) != sizeof(header)) {
+                break;
+            }
+            uint64_t key;
+            uint32_t length;
+            memcpy(&key, header, sizeof(key));
+            memcpy(&length, header + sizeof(key), sizeof(length));
+            if (offset + sizeof(header) + length > size) {
+                break;
+            }
+            diskIndex_[key] = {offset + sizeof(header), length};
+            offset += sizeof(header) + length;
+        }
+    }
+
+    bool readRecord(const Location &location, string &text) {
+        text.resize(location.length);
+        return pread(fileno(file_), text.data(), location.length, location.offset)
+               == static_cast<ssize_t>(location.length);
+    }
+
+    void remember(uint64_t key, const string &text) {
+        auto existing = lruIndex_.find(key);
+        if (existing != lruIndex_.end()) {
+            lru_.erase(existing->second);
+        }
+        lru_.emplace_front(key, text);
+        lruIndex_[key] = lru_.begin();
+        if (lru_.size() > kMemoryEntries) {
+            lruIndex_.erase(lru_.back().first);
+            lru_.pop_back();
+        }
+    }
+
+    std::mutex mutex_;
+    FILE *file_ = nullptr;
+    unordered_map<uint64_t, Location> diskIndex_;
+    list<pair<uint64_t, string>> lru_;
+    unordered_map<uint64_t, list<pair<uint64_t, string>>::iterator> lruIndex_;
+};
+
+// Route name (see ModelRouter) that sends transcripts to the local categorization backend
+static const string kLocalCategorizationModel = "local";
+
+/**
+ * Model serving categorization requests
+ * 
+ * A backend answers with a chat completions response whose message content is the
+ * categorized JSON, which categorizeTranscription parses and validates the same way
+ * whatever produced it.
+ */
+class CategorizationBackend {
+public:
+    virtual ~CategorizationBackend() = default;
+
+    virtual const char *name() const = 0;
+
+    // Whether the model runs on this machine (and competes for its CPU) rather than an API
+    virtual bool runsLocally() const {
+        return false;
+    }
+
+    /**
+     * Function to request the categorization of a transcription
+     *
+     * @param transcription The transcription text to analyze
+     * @param model The routed model
+     * @return The chat completions response, empty if the request failed
+     */
+    virtual string categorize(const string &transcription, const string &model) = 0;
+};
+
+/**
+ * Categorization with the OpenAI chat models (see categorizeWithOpenAI)
+ */
+class OpenAiCategorizationBackend : public CategorizationBackend {
+public:
+    explicit OpenAiCategorizationBackend(const string &apiKey) : apiKey_(apiKey) {}
+
+    const char *name() const override {
+        return "openai";
+    }
+
+    string categorize(const string &transcription, const string &model) override {
+        return categorizeWithOpenAI(transcription, apiKey_, model);
+    }
+
+private:
+    string apiKey_;
+};
+
+/**
+ * Categorization with a model served on this machine
+ * 
+ * Talks to an OpenAI-compatible chat completions server at VR_LOCAL_LLM_URL (default
+ * http://127.0.0.1:8080), such as llama.cpp's llama-server running a quantized
+ * instruction model (VR_LOCAL_LLM_MODEL names it in requests). The server keeps the
+ * model loaded, runs it with SIMD kernels and, with "cache_prompt", reuses the KV
+ * cache of the instructions shared by every request, so only the transcript is
+ * evaluated per note. The strict JSON schema is enforced by llama-server's grammar
+ * sampling. Pointing VR_LOCAL_LLM_URL at the mock API server stands in for it in tests.
+ */
+class LocalCategorizationBackend : public CategorizationBackend {
+public:
+    LocalCategorizationBackend() {
+        const char *url = getenv("VR_LOCAL_LLM_URL");
+        baseUrl_ = url && *url ? url : "http://127.0.0.1:8080";
+        while (!baseUrl_.empty() && baseUrl_.back() == '/') {
+            baseUrl_.pop_back();
+        }
+        const char *model = getenv("VR_LOCAL_LLM_MODEL");
+        model_ = model && *model ? model : "local";
+    }
+
+    const char *name() const override {
+        return "local";
+    }
+
+    bool runsLocally() const override {
+        return true;
+    }
+
+    string categorize(const string &transcription, const string &model) override {
+        string responseString;
+        CURL *curl = curl_easy_init();
+        if (!curl) {
+            return responseString;
+        }
+        string data = categorizationRequestBody(transcription, model_, "\n            \"cache_prompt\": true,");
+        struct curl_slist *headers = curl_slist_append(nullptr, "Content-Type: application/json");
+        string url = baseUrl_ + "/v1/chat/completions";
+        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+        curl_easy_setopt(curl, CURLOPT_POST, 1L);
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, data.c_str());
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &responseString);
+
+        auto startTime = chrono::steady_clock::now();
+        long httpStatus = 0;
+        CURLcode res = performHttpRequest(curl, "POST", url, data, responseString, &httpStatus);
+        if (res != CURLE_OK) {
+            cerr << "CURL error (local categorization at " << baseUrl_ << "): " << curl_easy_strerror(res) << endl;
+        } else if (httpStatus == 200 && HttpFixtures::instance().mode() != HttpFixtures::Mode::Replay) {
+            // Local latencies are tracked under the route name, for --model-stats and the latency budget
+            double milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+            ModelRouter::instance().recordLatency(model, estimateTokenCount(transcription), milliseconds);
+        }
+        curl_slist_free_all(headers);
+        curl_easy_cleanup(curl);
+        return responseString;
+    }
+
+private:
+    string baseUrl_;
+    string model_;
+};
+
+/**
+ * Function to create the backend serving a routed model
+ * 
+ * @param model The model chosen by ModelRouter; kLocalCategorizationModel selects the
+ *        local backend, any other name an OpenAI model
+ * @param apiKey OpenAI API key for the OpenAI backend
+ * @return The backend
+ */
+unique_ptr<CategorizationBackend> makeCategorizationBackend(const string &model, const string &apiKey) {
+    if (model == kLocalCategorizationModel) {
+        return make_unique<LocalCategorizationBackend>();
+    }
+    return make_unique<OpenAiCategorizationBackend>(apiKey);
+}
+
+/**
+ * Function to categorize a transcription and parse the result
+ * 
+ * Sends the transcription to the backend's chat model, which is asked for output
+ * matching CategorizationSchema. The reply is parsed and validated in one pass. A
+ * malformed reply (code fences, trailing commas, truncation, wrong value types) is
+ * repaired locally rather than discarded.
+ * 
+ * @param transcriptionText The transcription text to analyze
+ * @param backend The backend serving the model
+ * @param parsed Set to true if a result was obtained, false if the request failed or
+ *        the reply could not be repaired or lacks a required field (an empty object
+ *        is returned then)
+ * @param model The chat model to use
+ * @return The categorized JSON
+ */
+json categorizeTranscription(const string &transcriptionText, CategorizationBackend &backend, bool &parsed,
+                             const string &model = kCategorizationModel) {
+    string categorizedResponse = backend.categorize(transcriptionText, model);
+    
+    // Parse the categorized JSON response to extract the assistant's reply
+    json categorizedJson = json::object();
+    string assistantReply;
+    parsed = false;
+    
+    JsonFieldExtractor replyExtractor;
+    // Chat completions responses usually include a "choices" array
+    size_t contentField = replyExtractor.addField("choices.0.message.content", &assistantReply);
+    if (!replyExtractor.parse(categorizedResponse) || !replyExtractor.found(contentField)) {
+        cerr << "Error parsing chat completions JSON response: "
+             << (replyExtractor.error().empty() ? "no message content" : replyExtractor.error()) << endl;
+        cout << "Raw categorized response:" << endl << categorizedResponse << endl;
+        return categorizedJson;
+    }
+    cout << "Categorized Response:" << endl << assistantReply << endl;
+    
+    // Structured output parses directly; anything else is repaired locally
+    json reply = json::parse(assistantReply, nullptr, false);
+    if (reply.is_discarded()) {
+        reply = json::parse(repairJsonText(assistantReply), nullptr, false);
+        if (!reply.is_discarded()) {
+            cout << "Repaired malformed JSON in the reply" << endl;
+        }
+    }
+    vector<string> repairs;
+    if (reply.is_discarded() || !CategorizationSchema::instance().validate(reply, repairs)) {
+        cerr << "Error parsing categorized JSON: the reply is not a JSON object with a title and summary" << endl;
+        return categorizedJson;
+    }
+    for (const string &repair : repairs) {
+        cout << "Schema repair: " << repair << endl;
+    }
+    parsed = true;
+    cout << "Parsed JSON successfully" << endl;
+    return reply;
+}
+
+/**
+ * Schema of one Notion database, as needed to write pages to it
+ * 
+ * Built by ensureNotionDatabaseProperties and never modified afterwards, so any number
+ * of concurrent jobs can read it without locking. Each job resolves it once, through
+ * NotionDatabaseRegistry, and passes it on to every request it sends to the database.
+ */
+struct NotionDatabaseContext {
+    string databaseId;
+    // Name of the title property, which receives AI_Title
+    string titlePropertyName;
+    // Notion type of every property, by property name
+    map<string, string> propertyTypes;
+    // Property name for each categorized field that the database names differently
+    map<string, string> propertyNameMap;
+
+    /**
+     * Function to find the property a categorized field is written to
+     * 
+     * @param field Name of the field in the categorized JSON
+     * @return The property name in this database
+     */
+    string propertyName(const string &field) const {
+        auto found = propertyNameMap.find(field);
+        return found == propertyNameMap.end() ? field : found->second;
+    }
+};
+
+/**
+ * Function to ensure the Notion database has the required properties
+ * 
+ * This function:
+ * 1. Retrieves the current structure of the Notion database
+ * 2. Identifies the title property
+ * 3. Checks for missing properties or properties with incorrect types
+ * 4. Adds any missing properties with the correct types
+ * 5. Returns the resulting NotionDatabaseContext
+ * 
+ * A property whose name differs only in case (e.g. "Main points") is used as is.
+ * Required properties include:
+ * - Title property (for Summary)
+ * - Type (select)
+ * - Duration (rich_text)
+ * - At Cost (number)
+ * - Duration (Seconds) (number)
+ * - Date (date)
+ * - Main Points, Action Items, etc. (rich_text)
+ * 
+ * @param notionDatabaseId ID of the Notion database
+ * @param notionApiKey Notion API key for authentication
+ * @param database Receives the context of the database if it is ready
+ * @return true if the database has all required properties, false otherwise
+ */
+bool ensureNotionDatabaseProperties(const string &notionDatabaseId, const string &notionApiKey,
+                                    shared_ptr<const NotionDatabaseContext> &database) {
+    // Get the current database structure
+    CURL *curl;
+    CURLcode res;
+    string responseString;
+    
+    curl = curl_easy_init();
+    if (!curl) {
+        cerr << "Failed to initialize CURL for database retrieval" << endl;
+        return false;
+    }
+    
+    // Set up the required headers
+    struct curl_slist *headers = nullptr;
+    headers = curl_slist_append(headers, ("Authorization: Bearer " + notionApiKey).c_str());
+    headers = curl_slist_append(headers, "Content-Type: application/json");
+    headers = curl_slist_append(headers, "Notion-Version: 2022-06-28");
+    
+    // Set the Notion API endpoint for retrieving the database
+    string url = notionBaseUrl() + "/v1/databases/" + notionDatabaseId;
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &responseString);
+    
+    // Perform the request
+    res = performHttpRequest(curl, "GET", url, "", responseString);
+    if (res != CURLE_OK) {
+        cerr << "CURL error (database retrieval): " << curl_easy_strerror(res) << endl;
+        curl_slist_free_all(headers);
+        curl_easy_cleanup(curl);
+        return false;
+    }
+    
+    // Parse the response to check existing properties
+    try {
+        // Only the error status and the property types are needed, so skip building a DOM
+        string objectType;
+        string errorMessage;
+        map<string, string> existingProps;
+        JsonFieldExtractor dbExtractor;
+        dbExtractor.addField("object", &objectType);
+        dbExtractor.addField("message", &errorMessage);
+        dbExtractor.addFieldPattern("properties.*.type", [&existingProps](const string &name, string &type) {
+            existingProps[name] = move(type);
+        });
+        if (!dbExtractor.parse(responseString)) {
+            cerr << "Error parsing database response: " << dbExtractor.error() << endl;
+            cout << "Raw response:" << endl << responseString << endl;
+            curl_slist_free_all(headers);
+            curl_easy_cleanup(curl);
+            return false;
+        }
+        
+        // Check if there was an error
+        if (objectType == "error") {
+            cerr << "Notion API error (database retrieval): " << errorMessage << endl;
+            cout << "Notion API response:" << endl << responseString << endl;
+            curl_slist_free_all(headers);
+            curl_easy_cleanup(curl);
+            return false;
+        }
+        
+        // Find the existing title property
+        string titlePropName = "";
+        for (auto& [key, value] : existingProps) {
+            if (value == "title") {
+                titlePropName = key;
+                break;
+            }
+        }
+        
+        if (titlePropName.empty()) {
+            cerr << "No title property found in the database" << endl;
+            curl_slist_free_all(headers);
+            curl_easy_cleanup(curl);
+            return false;
+        }
+        
+        cout << "Found title property: " << titlePropName << endl;
+        
+        // Record the schema for the jobs writing to this database
+        auto context = make_shared<NotionDatabaseContext>();
+        context->databaseId = notionDatabaseId;
+        context->titlePropertyName = titlePropName;
+        context->propertyTypes = existingProps;
+        
+        // Define required properties with their types based on Notion Voice Notes configuration
+        map<string, string> requiredProps = {
+            {"Main Points", "rich_text"},
+            {"Action Items", "rich_text"},
+            {"Follow-up Questions", "rich_text"},
+            {"Stories", "rich_text"},
+            {"References", "rich_text"},
+            {"Arguments", "rich_text"},
+            {"Sentiment", "rich_text"},
+            {"Type", "select"},
+            {"Duration", "rich_text"},
+            {"AI Cost", "number"},
+            {"Duration (Seconds)", "number"},
+            {"Date", "date"},
+            {"Icon", "rich_text"}
+        };
+        
+        // Check which properties are missing or have the wrong type
+        vector<pair<string, string>> missingProps;
+        for (const auto& [propName, propType] : requiredProps) {
+            auto existing = existingProps.find(propName);
+            if (existing == existingProps.end()) {
+                existing = find_if(existingProps.begin(), existingProps.end(), [&propName](const auto &prop) {
+                    return strcasecmp(prop.first.c_str(), propName.c_str()) == 0;
+                });
+                if (existing != existingProps.end()) {
+                    context->propertyNameMap[propName] = existing->first;
+                }
+            }
+            if (existing == existingProps.end()) {
+                missingProps.push_back({propName, propType});
+            } else if (existing->second != propType) {
+                cerr << "Warning: Property '" << existing->first << "' exists but has type '" 
+                     << existing->second << "' instead of '" << propType << "'" << endl;
+            }
+        }
+        
+        // If no properties are missing, return success
+        if (missingProps.empty()) {
+            cout << "All required properties exist in the database" << endl;
+            database = move(context);
+            curl_slist_free_all(headers);
+            curl_easy_cleanup(curl);
+            return true;
+        }
+        
+        // Build the update payload
+        json updatePayload;
+        json properties;
+        
+        for (const auto& [propName, propType] : missingProps) {
+            if (propType == "rich_text") {
+                properties[propName] = {{"type", "rich_text"}, {"rich_text", json::object()}};
+            } else if (propType == "select") {
+                properties[propName] = {{"type", "select"}, {"select", json::object()}};
+            } else if (propType == "number") {
+                properties[propName] = {{"type", "number"}, {"number", json::object()}};
+            } else if (propType == "date") {
+                properties[propName] = {{"type", "date"}, {"date", json::object()}};
+            }
+        }
+        
+        updatePayload["properties"] = properties;
+        string updatePayloadStr = updatePayload.dump();
+        
+        // Reset CURL for the update request
+        curl_easy_reset(curl);
+        
+        // Set up the PATCH request
+        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+        curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "PATCH");
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, updatePayloadStr.c_str());
+        
+        // Clear the response string
+        responseString.clear();
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &responseString);
+        
+        // Perform the update request
+        res = performHttpRequest(curl, "PATCH", url, updatePayloadStr, responseString);
+        if (res != CURLE_OK) {
+            cerr << "CURL error (database update): " << curl_easy_strerror(res) << endl;
+            curl_slist_free_all(headers);
+            curl_easy_cleanup(curl);
+            return false;
+        }
+        
+        // Check the update response
+        string updateObjectType;
+        string updateErrorMessage;
+        JsonFieldExtractor updateExtractor;
+        updateExtractor.addField("object", &updateObjectType);
+        updateExtractor.addField("message", &updateErrorMessage);
+        if (!updateExtractor.parse(responseString)) {
+            cerr << "Error parsing database update response: " << updateExtractor.error() << endl;
+            cout << "Raw response:" << endl << responseString << endl;
+            curl_slist_free_all(headers);
+            curl_easy_cleanup(curl);
+            return false;
+        }
+        if (updateObjectType == "error") {
+            cerr << "Notion API error (database update): " << updateErrorMessage << endl;
+            cout << "Notion API response:" << endl << responseString << endl;
+            curl_slist_free_all(headers);
+            curl_easy_cleanup(curl);
+            return false;
+        }
+        
+        cout << "Database properties updated successfully" << endl;
+        for (const auto& [propName, propType] : missingProps) {
+            context->propertyTypes[propName] = propType;
+        }
+        database = move(context);
+        
+    } catch (const exception& e) {
+        cerr << "Error processing database response: " << e.what() << endl;
+        cout << "Raw response:" << endl << responseString << endl;
+        curl_slist_free_all(headers);
+        curl_easy_cleanup(curl);
+        return false;
+    }
+    
+    // Clean up
+    curl_slist_free_all(headers);
+    curl_easy_cleanup(curl);
+    
+    return true;
+}
+
+/**
+ * Registry of the contexts of every Notion database the process writes to
+ * 
+ * One process can serve many databases (e.g. one per team). Each database has its
+ * own slot: the first use starts ensureNotionDatabaseProperties for it on its own
+ * thread, and every use shares the future of that load, so a slow or failing
+ * database never holds up the first use of another one. The registry's mutex only
+ * guards the map of slots; jobs look up their database once and hand the context to
+ * the requests, which never touch the registry. A load that failed is started again
+ * by the next use of its database.
+ */
+class NotionDatabaseRegistry {
+public:
+    using ContextFuture = shared_future<shared_ptr<const NotionDatabaseContext>>;
+
+    static NotionDatabaseRegistry &instance() {
+        static NotionDatabaseRegistry registry;
+        return registry;
+    }
+
+    /**
+     * Function to get the context of a database, loading it on first use
+     * 
+     * @param databaseId ID of the Notion database
+     * @param notionApiKey Notion API key for authentication
+     * @return Future of the context, which holds nullptr if the database could not be prepared
+     */
+    ContextFuture context(const string &databaseId, const string &notionApiKey) {
+        lock_guard<mutex> lock(mutex_);
+        ContextFuture &slot = contexts_[databaseId];
+        bool failed = slot.valid() && slot.wait_for(chrono::seconds(0)) == future_status::ready && !slot.get();
+        if (!slot.valid() || failed) {
+            slot = async(launch::async, [databaseId, notionApiKey] {
+                shared_ptr<const NotionDatabaseContext> database;
+                ensureNotionDatabaseProperties(databaseId, notionApiKey, database);
+                return database;
+            }).share();
+        }
+        return slot;
+    }
+
+private:
+    NotionDatabaseRegistry() = default;
+
+    map<string, ContextFuture> contexts_;
+    std::mutex mutex_;
+};
+
+/**
+ * Function to convert categorized JSON into Notion page properties
+ * 
+ * Handles the different property types (title, select, number, date, rich_text) and
+ * converts arrays to comma-separated strings without square brackets. The title goes
+ * to the database's title property, and every other field to the property the
+ * database context maps it to.
+ * 
+ * @param data The categorized JSON data
+ * @param database Context of the database the page belongs to
+ * @return The "properties" object of a page create or update request
+ */
+json buildNotionProperties(const json &data, const NotionDatabaseContext &database) {
+    json properties;
+    // Iterate over the key/value pairs in the input JSON.
+    for (auto& [key, value] : data.items()) {
+        string propertyName = database.propertyName(key);
+        // Handle each property based on its expected type in Notion
+        if (key == "AI_Title" || key == "Title") {
+            // Use the title property name from the database
+            string content = value.is_string() ? value.get<string>() : value.dump();
+            properties[database.titlePropertyName] = {
+                {"title", json::array({
+                    {{"text", {{"content", content}}}}
+                })}
+            };
+        } else if (key == "Summary") {
+            // Use the title property name from the database if AI_Title is not present
+            if (!data.contains("AI_Title") && !data.contains("Title")) {
+                string content = value.is_string() ? value.get<string>() : value.dump();
+                properties[database.titlePropertyName] = {
+                    {"title", json::array({
+                        {{"text", {{"content", content}}}}
+                    })}
+                };
+            }
+        } else if (key == "Type") {
+            // Type is a select property
+            string content = value.is_string() ? value.get<string>() : value.dump();
+            properties[propertyName] = {
+                {"select", {{"name", content}}}
+            };
+        } else if (key == "At Cost" || key == "AI Cost") {
+            // AI Cost is a number property
+            // If the value is null or not a number, set it to null
+            string propName = database.propertyName("AI Cost"); // Use the Notion Voice Notes property name
+            if (value.is_null()) {
+                properties[propName] = {{"number", nullptr}};
+            } else if (value.is_number()) {
+                properties[propName] = {{"number", value}};
+            } else {
+                // Try to convert string to number
+                try {
+                    double numValue = stod(value.is_string() ? value.get<string>() : value.dump());
+                    properties[propName] = {{"number", numValue}};
+                } catch (...) {
+                    properties[propName] = {{"number", nullptr}};
+                }
+            }
+        } else if (key == "Duration (Seconds)") {
+            // Duration (Seconds) is a number property
+            if (value.is_number()) {
+                properties[propertyName] = {{"number", value}};
+            } else {
+                // Try to convert string to number
+                try {
+                    double numValue = stod(value.is_string() ? value.get<string>() : value.dump());
+                    properties[propertyName] = {{"number", numValue}};
+                } catch (...) {
+                    properties[propertyName] = {{"number", 0}};
+                }
+            }
+        } else if (key == "Date") {
+            // Date is a date property
+            if (value.is_null()) {
+                properties[propertyName] = {{"date", nullptr}};
+            } else {
+                string dateStr = value.is_string() ? value.get<string>() : value.dump();
+                if (dateStr == "null" || dateStr.empty()) {
+                    properties[propertyName] = {{"date", nullptr}};
+                } else {
+                    properties[propertyName] = {{"date", {{"start", dateStr}}}};
+                }
+            }
+        } else {
+            // All other properties are rich_text
+            if (value.is_array()) {
+                // Convert array to string without square brackets
+                ostringstream contentStream;
+                for (size_t i = 0; i < value.size(); ++i) {
+                    string itemText = value[i].is_string() ? value[i].get<string>() : value[i].dump();
+                    contentStream << itemText;
+                    if (i < value.size() - 1) {
+                        contentStream << ", ";
+                    }
+                }
+                string content = contentStream.str();
+                properties[propertyName] = {
+                    {"rich_text", json::array({
+                        {{"text", {{"content", content}}}}
+                    })}
+                };
+            } else {
+                // Handle non-array values as before
+                string content = value.is_string() ? value.get<string>() : value.dump();
+                properties[propertyName] = {
+                    {"rich_text", json::array({
                         {{"text", {{"content", content}}}}
                     })}
                 };
             }
-        } else if (key == "Type") {
-            // Type is a select property
-            string content = value.is_string() ? value.get<string>() : value.dump();
-            properties[key] = {
-                {"select", {{"name", content}}}
-            };
-        } else if (key == "At Cost" || key == "AI Cost") {
-            // AI Cost is a number property
-            // If the value is null or not a number, set it to null
-            string propName = "AI Cost"; // Use the Notion Voice Notes property name
-            if (value.is_null()) {
-                properties[propName] = {{"number", nullptr}};
-            } else if (value.is_number()) {
-                properties[propName] = {{"number", value}};
+        }
+    }
+    return properties;
+}
+
+/**
+ * Function to send a page create or update request to the Notion API
+ * 
+ * @param method "POST" to create a page, "PATCH" to update one
+ * @param url Endpoint URL
+ * @param payloadStr The JSON request body
+ * @param notionApiKey Notion API key for authentication
+ * @param pageId Optional output for the ID of the page
+ * @return true if Notion accepted the request, false otherwise
+ */
+bool sendNotionPageRequest(const char *method, const string &url, const string &payloadStr,
+                           const string &notionApiKey, string *pageId) {
+    // Set up CURL for the HTTP request to Notion's API.
+    CURL *curl;
+    CURLcode res;
+    string responseString;
+    
+    curl = curl_easy_init();
+    if (curl) {
+        // Set up the required headers.
+        struct curl_slist *headers = nullptr;
+        headers = curl_slist_append(headers, ("Authorization: Bearer " + notionApiKey).c_str());
+        headers = curl_slist_append(headers, "Content-Type: application/json");
+        headers = curl_slist_append(headers, "Notion-Version: 2022-06-28"); // Adjust if needed
+
+        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+        curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, method);
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, payloadStr.c_str());
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &responseString);
+        
+        // Perform the request
+        res = performHttpRequest(curl, method, url, payloadStr, responseString);
+        if (res != CURLE_OK) {
+            cerr << "CURL error (Notion API): " << curl_easy_strerror(res) << endl;
+            curl_slist_free_all(headers);
+            curl_easy_cleanup(curl);
+            return false;
+        }
+        
+        // Check the response for errors
+        string objectType;
+        string errorMessage;
+        JsonFieldExtractor extractor;
+        extractor.addField("object", &objectType);
+        extractor.addField("message", &errorMessage);
+        if (pageId) {
+            extractor.addField("id", pageId);
+        }
+        if (!extractor.parse(responseString)) {
+            // If we can't parse the response, just print it
+            cout << "Notion API response:" << endl << responseString << endl;
+        } else if (objectType == "error") {
+            cerr << "Notion API error: " << errorMessage << endl;
+            cout << "Notion API response:" << endl << responseString << endl;
+            curl_slist_free_all(headers);
+            curl_easy_cleanup(curl);
+            return false;
+        }
+        
+        // Clean up
+        curl_slist_free_all(headers);
+        curl_easy_cleanup(curl);
+    }
+    
+    return true;
+}
+
+/**
+ * Function to send a parsed JSON object into a Notion database
+ * 
+ * This function:
+ * 1. Ensures the database has the required properties
+ * 2. Builds a JSON payload according to Notion's API requirements
+ * 3. Sends the data to the Notion API as a new page
+ * 
+ * @param data The JSON data to send to Notion
+ * @param database Context of the Notion database, prepared by ensureNotionDatabaseProperties
+ * @param notionApiKey Notion API key for authentication
+ * @param pageId Optional output for the ID of the created page
+ * @return true if the data was successfully sent, false otherwise
+ */
+bool sendToNotion(const json &data, const NotionDatabaseContext &database, const string &notionApiKey,
+                  string *pageId = nullptr) {
+    // Build the JSON payload according to Notion's API requirements.
+    // The payload includes:
+    //   - A "parent" key specifying the database_id.
+    //   - A "properties" key that maps each key from your parsed JSON
+    //     into a Notion property.
+    json payload;
+    payload["parent"] = {{"database_id", database.databaseId}};
+    payload["properties"] = buildNotionProperties(data, database);
+    return sendNotionPageRequest("POST", notionBaseUrl() + "/v1/pages", payload.dump(), notionApiKey, pageId);
+}
+
+/**
+ * Function to update the properties of an existing Notion page
+ * 
+ * Used to fill in the categorized fields of a page that was created early with
+ * only its basic metadata.
+ * 
+ * @param data The JSON data to write to the page
+ * @param database Context of the Notion database the page belongs to
+ * @param pageId ID of the page
+ * @param notionApiKey Notion API key for authentication
+ * @return true if the page was updated, false otherwise
+ */
+bool updateNotionPage(const json &data, const NotionDatabaseContext &database, const string &pageId,
+                      const string &notionApiKey) {
+    json payload;
+    payload["properties"] = buildNotionProperties(data, database);
+    return sendNotionPageRequest("PATCH", notionBaseUrl() + "/v1/pages/" + pageId, payload.dump(), notionApiKey, nullptr);
+}
+
+/**
+ * Function to build the page metadata that is known before categorization
+ * 
+ * The page title is the audio file's name until the categorized AI title replaces it.
+ * 
+ * @param filePath Path to the audio file
+ * @param audioSeconds Length of the recording, or 0 if unknown
+ * @return JSON in the categorized format with AI_Title, Date and, if known, Duration
+ */
+json earlyNotionMetadata(const string &filePath, double audioSeconds) {
+    json metadata;
+    metadata["AI_Title"] = std::filesystem::path(filePath).stem().string();
+
+    time_t now = time(nullptr);
+    tm localTime;
+    localtime_r(&now, &localTime);
+    ostringstream date;
+    date << put_time(&localTime, "%Y-%m-%d");
+    metadata["Date"] = date.str();
+
+    if (audioSeconds > 0) {
+        long seconds = lround(audioSeconds);
+        ostringstream duration;
+        duration << setfill('0') << setw(2) << seconds / 3600 << ":" << setw(2) << seconds / 60 % 60
+                 << ":" << setw(2) << seconds % 60;
+        metadata["Duration"] = duration.str();
+        metadata["Duration (Seconds)"] = seconds;
+    }
+    return metadata;
+}
+
+/**
+ * Buffered output sink for rendered LaTeX
+ * 
+ * The sink appends into a caller-owned string buffer so the same allocation can be
+ * reused across many reports. When a file is attached, the buffer is flushed to it
+ * with large sequential writes once it grows past the flush threshold, so rendering
+ * never holds more than one chunk of a document in memory.
+ */
+class LatexSink {
+public:
+    static const size_t kFlushThreshold = 256 * 1024;
+
+    explicit LatexSink(string &buffer, FILE *file = nullptr) : buffer_(buffer), file_(file), failed_(false) {
+        buffer_.clear();
+        if (buffer_.capacity() < kFlushThreshold) {
+            buffer_.reserve(kFlushThreshold);
+        }
+    }
+
+    ~LatexSink() {
+        flush();
+    }
+
+    // Append raw LaTeX markup
+    void write(const char *text, size_t length) {
+        buffer_.append(text, length);
+        if (file_ && buffer_.size() >= kFlushThreshold) {
+            flush();
+        }
+    }
+
+    void write(const string &text) {
+        write(text.data(), text.size());
+    }
+
+    template <size_t N>
+    void write(const char (&text)[N]) {
+        write(text, N - 1);
+    }
+
+    // Append user-provided text with LaTeX special characters escaped
+    void writeEscaped(const string &text) {
+        size_t runStart = 0;
+        for (size_t i = 0; i < text.size(); ++i) {
+            const char *replacement = nullptr;
+            switch (text[i]) {
+                case '\\': replacement = "\\textbackslash{}"; break;
+                case '&': replacement = "\\&"; break;
+                case '%': replacement = "\\%"; break;
+                case '$': replacement = "\\$"; break;
+                case '#': replacement = "\\#"; break;
+                case '_': replacement = "\\_"; break;
+                case '{': replacement = "\\{"; break;
+                case '}': replacement = "\\}"; break;
+                case '~': replacement = "\\textasciitilde{}"; break;
+                case '^': replacement = "\\textasciicircum{}"; break;
+                default: continue;
+            }
+            buffer_.append(text, runStart, i - runStart);
+            buffer_.append(replacement);
+            runStart = i + 1;
+        }
+        buffer_.append(text, runStart, string::npos);
+        if (file_ && buffer_.size() >= kFlushThreshold) {
+            flush();
+        }
+    }
+
+    // Write any buffered output to the attached file
+    void flush() {
+        if (file_ && !buffer_.empty()) {
+            if (fwrite(buffer_.data(), 1, buffer_.size(), file_) != buffer_.size()) {
+                failed_ = true;
+            }
+            buffer_.clear();
+        }
+    }
+
+    bool failed() const {
+        return failed_;
+    }
+
+private:
+    string &buffer_;
+    FILE *file_;
+    bool failed_;
+};
+
+/**
+ * Section descriptors for the LaTeX report
+ * 
+ * Each entry maps a field of the categorized JSON to a section of the report.
+ * The renderer walks these tables in order, so adding a section to the report
+ * only requires adding a row here.
+ */
+enum class LatexSectionStyle {
+    Itemize,    // Arrays become \item lists, scalars a single \item
+    Paragraph,  // Rendered as plain text
+    Arguments   // Objects become subsections, arrays an itemize, scalars plain text
+};
+
+struct LatexMetadataRow {
+    const char *label;
+    const char *key;
+    const char *fallbackKey;
+};
+
+struct LatexSection {
+    const char *key;
+    LatexSectionStyle style;
+};
+
+static const LatexMetadataRow kLatexMetadataRows[] = {
+    {"Type", "Type", nullptr},
+    {"Duration", "Duration", nullptr},
+    {"AI Cost", "AI Cost", "At Cost"},
+    {"Date", "Date", nullptr},
+    {"Icon", "Icon", nullptr}
+};
+
+static const LatexSection kLatexSections[] = {
+    {"Main Points", LatexSectionStyle::Itemize},
+    {"Action Items", LatexSectionStyle::Itemize},
+    {"Follow-up Questions", LatexSectionStyle::Itemize},
+    {"Arguments", LatexSectionStyle::Arguments},
+    {"References", LatexSectionStyle::Itemize},
+    {"Stories", LatexSectionStyle::Itemize},
+    {"Sentiment", LatexSectionStyle::Paragraph}
+};
+
+static const char kLatexPreamble[] =
+    "\\documentclass{article}\n"
+    "\\usepackage{geometry}\n"
+    "\\usepackage{enumitem}\n"
+    "\\usepackage{hyperref}\n"
+    "\\usepackage{xcolor}\n"
+    "\\usepackage{titlesec}\n"
+    "\\usepackage{fancyhdr}\n"
+    "\\usepackage{booktabs}\n"
+    "\\geometry{margin=1in}\n"
+    "\\titleformat{\\section}{\\normalfont\\Large\\bfseries}{\\thesection}{1em}{}\n"
+    "\\pagestyle{fancy}\n"
+    "\\fancyhf{}\n"
+    "\\renewcommand{\\headrulewidth}{0pt}\n"
+    "\\fancyfoot[C]{\\thepage}\n"
+    "\\begin{document}\n\n";
+
+/**
+ * Function to write a JSON value as escaped LaTeX text
+ * 
+ * Strings are written as-is (escaped); any other JSON value is written as its JSON dump.
+ * 
+ * @param value The JSON value to write
+ * @param sink The sink receiving the LaTeX output
+ */
+void writeLatexValue(const json &value, LatexSink &sink) {
+    if (value.is_string()) {
+        sink.writeEscaped(value.get_ref<const string&>());
+    } else {
+        sink.writeEscaped(value.dump());
+    }
+}
+
+/**
+ * Function to write a JSON value as an itemize list
+ * 
+ * @param value An array (one \item per element) or a scalar (a single \item)
+ * @param sink The sink receiving the LaTeX output
+ */
+void writeLatexItemize(const json &value, LatexSink &sink) {
+    sink.write("\\begin{itemize}[leftmargin=*]\n");
+    if (value.is_array()) {
+        for (const auto &item : value) {
+            sink.write("  \\item ");
+            writeLatexValue(item, sink);
+            sink.write("\n");
+        }
+    } else {
+        sink.write("  \\item ");
+        writeLatexValue(value, sink);
+        sink.write("\n");
+    }
+    sink.write("\\end{itemize}\n\n");
+}
+
+/**
+ * Function to render categorized JSON data as a LaTeX document
+ * 
+ * The document layout is driven by kLatexMetadataRows and kLatexSections.
+ * Every field is looked up once and all user-provided text is escaped.
+ * 
+ * @param data The categorized JSON data
+ * @param sink The sink receiving the LaTeX output
+ */
+void renderLatex(const json &data, LatexSink &sink) {
+    sink.write(kLatexPreamble);
+
+    // Add the title
+    auto summary = data.find("Summary");
+    if (summary != data.end()) {
+        sink.write("\\title{");
+        writeLatexValue(*summary, sink);
+        sink.write("}\n"
+                   "\\author{Generated by AI Analysis}\n"
+                   "\\date{\\today}\n"
+                   "\\maketitle\n\n");
+    }
+
+    // Add metadata section
+    sink.write("\\section*{Metadata}\n"
+               "\\begin{tabular}{ll}\n"
+               "\\toprule\n");
+    for (const auto &row : kLatexMetadataRows) {
+        auto value = data.find(row.key);
+        if (value == data.end() && row.fallbackKey) {
+            value = data.find(row.fallbackKey);
+        }
+        if (value != data.end()) {
+            sink.write(row.label, strlen(row.label));
+            sink.write(" & ");
+            writeLatexValue(*value, sink);
+            sink.write(" \\\\\n");
+        }
+    }
+    sink.write("\\bottomrule\n"
+               "\\end{tabular}\n\n");
+
+    // Add the content sections
+    for (const auto &section : kLatexSections) {
+        auto value = data.find(section.key);
+        if (value == data.end()) {
+            continue;
+        }
+
+        sink.write("\\section{");
+        sink.write(section.key, strlen(section.key));
+        sink.write("}\n");
+
+        switch (section.style) {
+            case LatexSectionStyle::Itemize:
+                writeLatexItemize(*value, sink);
+                break;
+            case LatexSectionStyle::Paragraph:
+                writeLatexValue(*value, sink);
+                sink.write("\n\n");
+                break;
+            case LatexSectionStyle::Arguments:
+                if (value->is_object()) {
+                    for (const auto &[argTitle, argContent] : value->items()) {
+                        sink.write("\\subsection*{");
+                        sink.writeEscaped(argTitle);
+                        sink.write("}\n");
+                        writeLatexValue(argContent, sink);
+                        sink.write("\n\n");
+                    }
+                } else if (value->is_array()) {
+                    writeLatexItemize(*value, sink);
+                } else {
+                    writeLatexValue(*value, sink);
+                    sink.write("\n\n");
+                }
+                break;
+        }
+    }
+
+    // End the document
+    sink.write("\\end{document}\n");
+}
+
+/**
+ * Function to convert JSON data to LaTeX format
+ * 
+ * @param data The categorized JSON data
+ * @return The complete LaTeX document
+ */
+string convertToLatex(const json &data) {
+    string latex;
+    LatexSink sink(latex);
+    renderLatex(data, sink);
+    return latex;
+}
+
+/**
+ * Function to render JSON data straight into a LaTeX file
+ * 
+ * The document is streamed through a LatexSink, so no full copy of it is built in memory.
+ * Callers rendering many reports can pass the same buffer to every call to avoid
+ * reallocating it.
+ * 
+ * @param data The categorized JSON data
+ * @param filePath Path of the .tex file to write
+ * @param buffer Reusable scratch buffer for the sink
+ * @return true if the file was written successfully, false otherwise
+ */
+bool saveLatexToFile(const json &data, const string &filePath, string &buffer) {
+    FILE *file = fopen(filePath.c_str(), "wb");
+    if (!file) {
+        cerr << "Failed to open file for writing: " << filePath << endl;
+        return false;
+    }
+    // The sink does its own buffering, so stdio buffering would only add a copy
+    setvbuf(file, nullptr, _IONBF, 0);
+
+    bool failed;
+    {
+        LatexSink sink(buffer, file);
+        renderLatex(data, sink);
+        sink.flush();
+        failed = sink.failed();
+    }
+
+    if (fclose(file) != 0 || failed) {
+        cerr << "Failed to write file: " << filePath << endl;
+        return false;
+    }
+    return true;
+}
+
+bool saveLatexToFile(const json &data, const string &filePath) {
+    string buffer;
+    if (!saveLatexToFile(data, filePath, buffer)) {
+        return false;
+    }
+    cout << "LaTeX saved to: " << filePath << endl;
+    return true;
+}
+
+/**
+ * Work-stealing thread pool
+ * 
+ * Each worker owns a deque of tasks. Workers take new work from the back of their
+ * own deque and, when it runs dry, steal from the front of another worker's deque,
+ * so uneven task sizes (e.g. a few very long reports) do not leave cores idle.
+ */
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(size_t threadCount) : queues_(max<size_t>(threadCount, 1)) {
+        for (auto &queue : queues_) {
+            queue = make_unique<WorkerQueue>();
+        }
+        for (size_t i = 0; i < queues_.size(); ++i) {
+            workers_.emplace_back([this, i] { workerLoop(i); });
+        }
+    }
+
+    ~WorkStealingPool() {
+        {
+            lock_guard<mutex> lock(stateMutex_);
+            stopping_ = true;
+        }
+        workAvailable_.notify_all();
+        for (auto &worker : workers_) {
+            worker.join();
+        }
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    size_t size() const {
+        return queues_.size();
+    }
+
+    // Queue a task; tasks are spread round-robin over the worker deques
+    void submit(function<void()> task) {
+        size_t index = nextQueue_.fetch_add(1, memory_order_relaxed) % queues_.size();
+        {
+            lock_guard<mutex> lock(queues_[index]->mutex);
+            queues_[index]->tasks.push_back(move(task));
+        }
+        {
+            lock_guard<mutex> lock(stateMutex_);
+            ++queued_;
+            ++unfinished_;
+        }
+        workAvailable_.notify_one();
+    }
+
+    // Block until every submitted task has finished
+    void wait() {
+        unique_lock<mutex> lock(stateMutex_);
+        allDone_.wait(lock, [this] { return unfinished_ == 0; });
+    }
+
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        deque<function<void()>> tasks;
+    };
+
+    bool popTask(size_t self, function<void()> &task) {
+        // Own deque first (LIFO for cache locality), then steal FIFO from the others
+        for (size_t offset = 0; offset < queues_.size(); ++offset) {
+            WorkerQueue &queue = *queues_[(self + offset) % queues_.size()];
+            lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.tasks.empty()) {
+                continue;
+            }
+            if (offset == 0) {
+                task = move(queue.tasks.back());
+                queue.tasks.pop_back();
+            } else {
+                task = move(queue.tasks.front());
+                queue.tasks.pop_front();
+            }
+            return true;
+        }
+        return false;
+    }
+
+    void workerLoop(size_t self) {
+        while (true) {
+            {
+                unique_lock<std::mutex> lock(stateMutex_);
+                workAvailable_.wait(lock, [this] { return stopping_ || queued_ > 0; });
+                if (queued_ == 0) {
+                    return;
+                }
+                --queued_;
+            }
+
+            // A slot was reserved above, so a task is guaranteed to be in some deque
+            function<void()> task;
+            while (!popTask(self, task)) {
+                this_thread::yield();
+            }
+            task();
+
+            lock_guard<std::mutex> lock(stateMutex_);
+            if (--unfinished_ == 0) {
+                allDone_.notify_all();
+            }
+        }
+    }
+
+    vector<unique_ptr<WorkerQueue>> queues_;
+    vector<thread> workers_;
+    atomic<size_t> nextQueue_{0};
+    std::mutex stateMutex_;
+    condition_variable workAvailable_;
+    condition_variable allDone_;
+    size_t queued_ = 0;
+    size_t unfinished_ = 0;
+    bool stopping_ = false;
+};
+
+/**
+ * Function to regenerate LaTeX reports for a directory of categorized JSON files
+ * 
+ * Every *.json file in the input directory is memory-mapped, parsed and rendered to
+ * <output directory>/<name>.tex. Files are processed in parallel on a work-stealing
+ * pool, and each worker reuses one render buffer for all of its reports.
+ * No network access is needed.
+ * 
+ * @param inputDir Directory containing categorized JSON files
+ * @param outputDir Directory the .tex files are written to (created if missing)
+ * @param threadCount Number of worker threads (0 = one per core)
+ * @return true if every report was generated, false otherwise
+ */
+bool bulkGenerateLatex(const string &inputDir, const string &outputDir, size_t threadCount) {
+    namespace fs = std::filesystem;
+    error_code ec;
+
+    vector<fs::path> inputFiles;
+    for (fs::directory_iterator it(inputDir, ec), end; !ec && it != end; it.increment(ec)) {
+        if (it->is_regular_file() && it->path().extension() == ".json") {
+            inputFiles.push_back(it->path());
+        }
+    }
+    if (ec) {
+        cerr << "Failed to read input directory " << inputDir << ": " << ec.message() << endl;
+        return false;
+    }
+    fs::create_directories(outputDir, ec);
+    if (ec) {
+        cerr << "Failed to create output directory " << outputDir << ": " << ec.message() << endl;
+        return false;
+    }
+
+    if (threadCount == 0) {
+        threadCount = max(1u, thread::hardware_concurrency());
+    }
+    cout << "Generating " << inputFiles.size() << " LaTeX reports on " << threadCount << " threads..." << endl;
+
+    auto startTime = chrono::steady_clock::now();
+    atomic<size_t> failures{0};
+    mutex errorMutex;
+    {
+        WorkStealingPool pool(threadCount);
+        for (const auto &inputPath : inputFiles) {
+            pool.submit([&, inputPath] {
+                thread_local string renderBuffer;
+                thread_local JobArena arena;
+                string error;
+
+                MappedFile mapped(inputPath.string());
+                if (!mapped.isOpen()) {
+                    error = "cannot open file";
+                } else {
+                    // The parsed document lives in the worker's arena, which is rewound after each report
+                    JobArenaScope arenaScope(arena);
+                    try {
+                        json data = json::parse(mapped.data(), mapped.data() + mapped.size());
+                        fs::path outputPath = fs::path(outputDir) / inputPath.stem();
+                        outputPath += ".tex";
+                        if (!saveLatexToFile(data, outputPath.string(), renderBuffer)) {
+                            error = "cannot write " + outputPath.string();
+                        }
+                    } catch (const exception &e) {
+                        error = e.what();
+                    }
+                }
+                arena.reset();
+
+                if (!error.empty()) {
+                    failures.fetch_add(1, memory_order_relaxed);
+                    lock_guard<mutex> lock(errorMutex);
+                    cerr << "Failed to render " << inputPath.string() << ": " << error << endl;
+                }
+            });
+        }
+        pool.wait();
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+
+    size_t generated = inputFiles.size() - failures.load();
+    cout << "Generated " << generated << " of " << inputFiles.size() << " reports in "
+         << fixed << setprecision(2) << seconds << "s";
+    if (seconds > 0) {
+        cout << " (" << static_cast<size_t>(generated / seconds) << " reports/s)";
+    }
+    cout << endl;
+    return failures.load() == 0;
+}
+
+/**
+ * Function to load the PDF build cache
+ * 
+ * The cache records, for every .tex file that was compiled successfully, the hash of
+ * the .tex content it was compiled from. Each line has the form "<hex hash> <file name>".
+ * 
+ * @param cachePath Path of the cache file
+ * @return Map from .tex file name to content hash
+ */
+map<string, uint64_t> loadPdfBuildCache(const string &cachePath) {
+    map<string, uint64_t> cache;
+    ifstream file(cachePath);
+    string line;
+    while (getline(file, line)) {
+        size_t space = line.find(' ');
+        if (space == string::npos) {
+            continue;
+        }
+        cache[line.substr(space + 1)] = strtoull(line.substr(0, space).c_str(), nullptr, 16);
+    }
+    return cache;
+}
+
+/**
+ * Function to save the PDF build cache
+ * 
+ * The file is written to a temporary name first and renamed into place, so an
+ * interrupted build never leaves a truncated cache behind.
+ * 
+ * @param cache Map from .tex file name to content hash
+ * @param cachePath Path of the cache file
+ * @return true if the cache was saved, false otherwise
+ */
+bool savePdfBuildCache(const map<string, uint64_t> &cache, const string &cachePath) {
+    string tempPath = cachePath + ".tmp";
+    {
+        ofstream file(tempPath);
+        if (!file.is_open()) {
+            return false;
+        }
+        for (const auto &[name, hash] : cache) {
+            file << hex << setw(16) << setfill('0') << hash << ' ' << name << '\n';
+        }
+        if (!file) {
+            return false;
+        }
+    }
+    return rename(tempPath.c_str(), cachePath.c_str()) == 0;
+}
+
+/**
+ * Function to start pdflatex for one .tex file in its own temporary directory
+ * 
+ * The child runs with the temporary directory as its working and output directory,
+ * so auxiliary files of concurrent builds never collide. Its console output is
+ * discarded; the full log stays in the temporary directory until it is cleaned up.
+ * 
+ * @param texPath Absolute path of the .tex file
+ * @param workDir Temporary directory for the build
+ * @return PID of the child process, or -1 on failure
+ */
+pid_t startPdflatex(const string &texPath, const string &workDir) {
+    // Built before forking: the child of a threaded process must not allocate
+    string outputDirArg = "-output-directory=" + workDir;
+    pid_t pid = fork();
+    if (pid != 0) {
+        return pid;
+    }
+
+    // Child process
+    if (chdir(workDir.c_str()) != 0) {
+        _exit(127);
+    }
+    int devNull = open("/dev/null", O_RDWR);
+    if (devNull >= 0) {
+        dup2(devNull, STDIN_FILENO);
+        dup2(devNull, STDOUT_FILENO);
+        dup2(devNull, STDERR_FILENO);
+    }
+    closeInheritedDescriptors();
+    execlp("pdflatex", "pdflatex", "-interaction=nonstopmode", "-halt-on-error",
+           outputDirArg.c_str(), texPath.c_str(), static_cast<char*>(nullptr));
+    _exit(127);
+}
+
+/**
+ * Function to compile a directory of LaTeX reports to PDF
+ * 
+ * Each .tex file is compiled by its own pdflatex process in an isolated temporary
+ * directory, with at most jobCount processes running at once. Files whose content
+ * hash matches the one recorded at their last successful build (and whose PDF still
+ * exists) are skipped, so rebuilding a large archive only compiles what changed.
+ * 
+ * @param texDir Directory containing .tex files
+ * @param pdfDir Directory the PDFs are written to (created if missing)
+ * @param jobCount Maximum number of concurrent pdflatex processes (0 = one per core)
+ * @return true if every out-of-date report compiled, false otherwise
+ */
+bool buildPdfReports(const string &texDir, const string &pdfDir, size_t jobCount) {
+    namespace fs = std::filesystem;
+    error_code ec;
+
+    fs::create_directories(pdfDir, ec);
+    if (ec) {
+        cerr << "Failed to create output directory " << pdfDir << ": " << ec.message() << endl;
+        return false;
+    }
+    string cachePath = (fs::path(pdfDir) / ".pdf_build_cache").string();
+    map<string, uint64_t> cache = loadPdfBuildCache(cachePath);
+
+    // Find the files whose content changed since their last build
+    struct PdfJob {
+        fs::path texPath;
+        string name;
+        uint64_t hash;
+        string workDir;
+    };
+    vector<PdfJob> pending;
+    size_t upToDate = 0;
+    for (fs::directory_iterator it(texDir, ec), end; !ec && it != end; it.increment(ec)) {
+        if (!it->is_regular_file() || it->path().extension() != ".tex") {
+            continue;
+        }
+        MappedFile mapped(it->path().string());
+        if (!mapped.isOpen()) {
+            cerr << "Failed to read " << it->path().string() << endl;
+            continue;
+        }
+        uint64_t hash = fnv1aHash(mapped.data(), mapped.size());
+        string name = it->path().filename().string();
+        fs::path pdfPath = fs::path(pdfDir) / it->path().stem();
+        pdfPath += ".pdf";
+
+        auto cached = cache.find(name);
+        if (cached != cache.end() && cached->second == hash && fs::exists(pdfPath)) {
+            ++upToDate;
+            continue;
+        }
+        pending.push_back({fs::absolute(it->path()), name, hash, ""});
+    }
+    if (ec) {
+        cerr << "Failed to read input directory " << texDir << ": " << ec.message() << endl;
+        return false;
+    }
+
+    if (jobCount == 0) {
+        jobCount = max(1u, thread::hardware_concurrency());
+    }
+    cout << "Compiling " << pending.size() << " reports with up to " << jobCount
+         << " pdflatex processes (" << upToDate << " up to date)..." << endl;
+
+    auto startTime = chrono::steady_clock::now();
+    map<pid_t, size_t> running;
+    size_t nextJob = 0;
+    size_t failures = 0;
+
+    while (nextJob < pending.size() || !running.empty()) {
+        // Keep the pool full
+        while (nextJob < pending.size() && running.size() < jobCount) {
+            PdfJob &job = pending[nextJob++];
+            string pattern = (fs::temp_directory_path() / "vr_pdf_XXXXXX").string();
+            if (!mkdtemp(pattern.data())) {
+                cerr << "Failed to create temporary directory for " << job.name << endl;
+                ++failures;
+                continue;
+            }
+            job.workDir = pattern;
+            pid_t pid = startPdflatex(job.texPath.string(), job.workDir);
+            if (pid < 0) {
+                cerr << "Failed to start pdflatex for " << job.name << endl;
+                fs::remove_all(job.workDir, ec);
+                ++failures;
+                continue;
+            }
+            running[pid] = nextJob - 1;
+        }
+        if (running.empty()) {
+            continue;
+        }
+
+        // Wait for one of the builds to finish; waitpid(-1) would also reap children started
+        // by other parts of the process (ffmpeg, whisper.cpp), which wait for them themselves
+        int status = 0;
+        auto finished = running.end();
+        while (finished == running.end()) {
+            for (auto candidate = running.begin(); candidate != running.end(); ++candidate) {
+                pid_t done = waitpid(candidate->first, &status, WNOHANG);
+                if (done < 0 && errno != EINTR) {
+                    status = -1;  // Lost track of the child: count the build as failed
+                }
+                if (done == candidate->first || status == -1) {
+                    finished = candidate;
+                    break;
+                }
+            }
+            if (finished == running.end()) {
+                this_thread::sleep_for(chrono::milliseconds(20));
+            }
+        }
+        PdfJob &job = pending[finished->second];
+        running.erase(finished);
+
+        fs::path builtPdf = fs::path(job.workDir) / job.texPath.stem();
+        builtPdf += ".pdf";
+        fs::path targetPdf = fs::path(pdfDir) / job.texPath.stem();
+        targetPdf += ".pdf";
+
+        bool succeeded = WIFEXITED(status) && WEXITSTATUS(status) == 0 && fs::exists(builtPdf);
+        if (succeeded) {
+            fs::rename(builtPdf, targetPdf, ec);
+            if (ec) {
+                // The temporary directory may live on another file system
+                ec.clear();
+                fs::copy_file(builtPdf, targetPdf, fs::copy_options::overwrite_existing, ec);
+            }
+            succeeded = !ec;
+        }
+
+        if (succeeded) {
+            cache[job.name] = job.hash;
+        } else {
+            ++failures;
+            if (WIFEXITED(status) && WEXITSTATUS(status) == 127) {
+                // Without pdflatex no other build can succeed either
+                if (nextJob < pending.size()) {
+                    failures += pending.size() - nextJob;
+                    nextJob = pending.size();
+                    cerr << "Failed to compile reports: pdflatex not found" << endl;
+                }
+            } else {
+                cerr << "Failed to compile " << job.name << " (see " << job.texPath.stem().string() << ".log)" << endl;
+                fs::path logPath = fs::path(job.workDir) / job.texPath.stem();
+                logPath += ".log";
+                fs::path targetLog = fs::path(pdfDir) / logPath.filename();
+                fs::copy_file(logPath, targetLog, fs::copy_options::overwrite_existing, ec);
+            }
+            cache.erase(job.name);
+        }
+        fs::remove_all(job.workDir, ec);
+    }
+
+    if (!savePdfBuildCache(cache, cachePath)) {
+        cerr << "Failed to save PDF build cache: " << cachePath << endl;
+    }
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+    cout << "Compiled " << pending.size() - failures << " of " << pending.size() << " reports in "
+         << fixed << setprecision(2) << seconds << "s" << endl;
+    return failures == 0;
+}
+
+/**
+ * Function to store the categorized JSON of a run for later offline processing
+ * 
+ * Files are written to the given directory with a timestamped name so that
+ * bulk regeneration (--bulk-latex) can rebuild every report without calling the APIs again.
+ * 
+ * @param data The categorized JSON data
+ * @param directory Directory to store the file in (created if missing)
+ * @return Path of the written file, or an empty string on failure
+ */
+string saveCategorizedJson(const json &data, const string &directory) {
+    error_code ec;
+    std::filesystem::create_directories(directory, ec);
+
+    auto now = chrono::system_clock::now();
+    time_t nowTime = chrono::system_clock::to_time_t(now);
+    auto millis = chrono::duration_cast<chrono::milliseconds>(now.time_since_epoch()).count() % 1000;
+    tm localTime;
+    localtime_r(&nowTime, &localTime);
+
+    // Concurrent jobs can finish within the same millisecond, so claim the name exclusively
+    string filePath;
+    for (int attempt = 0; ; ++attempt) {
+        ostringstream name;
+        name << put_time(&localTime, "%Y%m%d-%H%M%S") << "-" << setw(3) << setfill('0') << millis;
+        if (attempt > 0) {
+            name << "-" << attempt;
+        }
+        name << ".json";
+        filePath = (std::filesystem::path(directory) / name.str()).string();
+        int fd = open(filePath.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+        if (fd >= 0) {
+            close(fd);
+            break;
+        }
+        if (errno != EEXIST) {
+            cerr << "Failed to open file for writing: " << filePath << endl;
+            return "";
+        }
+    }
+
+    ofstream file(filePath);
+    if (!file.is_open()) {
+        cerr << "Failed to open file for writing: " << filePath << endl;
+        return "";
+    }
+    file << data.dump(2) << endl;
+    return file ? filePath : "";
+}
+
+/**
+ * Function to store the word and segment timings of a transcript
+ * 
+ * Writes one tab-separated line per span: "segment" or "word", start and end in
+ * milliseconds, and the span's text.
+ * 
+ * @param timings The timings
+ * @param filePath Path of the file to write
+ * @return true on success
+ */
+bool saveTimedTranscript(const TimedTranscript &timings, const string &filePath) {
+    ofstream file(filePath);
+    if (!file.is_open()) {
+        cerr << "Failed to open file for writing: " << filePath << endl;
+        return false;
+    }
+    string line;
+    auto writeSpans = [&](const TimedTranscript::Spans &spans, const char *kind) {
+        for (size_t i = 0; i < spans.size(); ++i) {
+            line = kind;
+            line += '\t' + to_string(spans.startMs[i]) + '\t' + to_string(spans.endMs[i]) + '\t';
+            for (char c : timings.spanText(spans, i)) {
+                line += c == '\t' || c == '\n' || c == '\r' ? ' ' : c;
+            }
+            line += '\n';
+            file << line;
+        }
+    };
+    writeSpans(timings.segments, "segment");
+    writeSpans(timings.words, "word");
+    return static_cast<bool>(file);
+}
+
+/**
+ * Function to call back for every search term in a text
+ * 
+ * Terms are runs of ASCII letters and digits, lowercased. Bytes of multi-byte UTF-8
+ * characters count as letters so accented words stay whole. Overlong runs (encoded
+ * blobs and the like) are skipped.
+ * 
+ * @param data The text
+ * @param size Length of the text in bytes
+ * @param callback Called with each term
+ */
+template <typename Callback>
+void forEachSearchTerm(const char *data, size_t size, Callback &&callback) {
+    static const size_t kMaxTermLength = 48;
+    string term;
+    for (size_t i = 0; i <= size; ++i) {
+        unsigned char c = i < size ? static_cast<unsigned char>(data[i]) : ' ';
+        if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c >= 0x80) {
+            term += static_cast<char>(c);
+        } else if (c >= 'A' && c <= 'Z') {
+            term += static_cast<char>(c - 'A' + 'a');
+        } else if (!term.empty()) {
+            if (term.size() <= kMaxTermLength) {
+                callback(term);
+            }
+            term.clear();
+        }
+    }
+}
+
+/**
+ * Function to collect the text of every string in a JSON value
+ * 
+ * @param value The JSON value (strings inside arrays and objects are included)
+ * @param text Receives the strings, one per line
+ */
+void appendSearchText(const json &value, string &text) {
+    if (value.is_string()) {
+        text += value.get_ref<const string&>();
+        text += '\n';
+    } else if (value.is_array() || value.is_object()) {
+        for (const auto &item : value) {
+            appendSearchText(item, text);
+        }
+    }
+}
+
+/**
+ * Local full-text index over every processed transcript
+ * 
+ * Each run appends its transcript and categorized fields to a document log. Documents
+ * are folded into an immutable inverted index in batches; queries read that index
+ * through a memory mapping and rank documents with BM25. Documents that are not yet
+ * folded in are tokenized at query time, so a new run is searchable immediately.
+ * 
+ * Files in the index directory (VR_SEARCH_INDEX, default "search"; "off" disables it),
+ * all integers little-endian:
+ *   documents.dat: per document, u32 length and bytes of title, source, snippet and text
+ *   index.dat:     header ("VRIDX001", document count, term count, total document length,
+ *                  size of documents.dat covered, section offsets), u32 length per document,
+ *                  u64 documents.dat offset per document, 32-byte term entries sorted by
+ *                  term, term bytes, and posting lists of varint (document id delta,
+ *                  term frequency) pairs
+ */
+class TranscriptSearchIndex {
+public:
+    struct Hit {
+        uint32_t document;
+        double score;
+        string title;
+        string source;
+        string snippet;
+    };
+
+    // Unindexed documents at which add() folds the log into the index
+    static const size_t kMergeThreshold = 512;
+    // Documents tokenized per merge pass, bounding the memory a large backfill needs
+    static const size_t kMergeBatch = 16384;
+
+    static TranscriptSearchIndex &instance() {
+        static TranscriptSearchIndex index;
+        return index;
+    }
+
+    bool enabled() const {
+        return !directory_.empty();
+    }
+
+    /**
+     * Function to add a document to the index
+     *
+     * @param title Title shown in search results
+     * @param source Path of the stored categorized JSON
+     * @param snippet Text shown under the title in search results
+     * @param text Full text to index (transcript and categorized fields)
+     * @param mergeWhenDue Fold the log into the index once enough documents are pending
+     * @return true if the document was stored
+     */
+    bool add(const string &title, const string &source, const string &snippet, const string &text,
+             bool mergeWhenDue = true) {
+        if (!enabled()) {
+            return false;
+        }
+        string record;
+        for (const string *field : {&title, &source, &snippet, &text}) {
+            uint32_t length = field->size();
+            record.append(reinterpret_cast<const char*>(&length), sizeof(length));
+            record += *field;
+        }
+        // Concurrent jobs append whole records and merge one at a time
+        lock_guard<mutex> lock(writeMutex_);
+        {
+            ofstream file(documentsPath(), ios::binary | ios::app);
+            file.write(record.data(), record.size());
+            if (!file) {
+                cerr << "Failed to update search index: " << documentsPath() << endl;
+                return false;
+            }
+        }
+        if (mergeWhenDue) {
+            IndexView index(indexPath());
+            MappedFile log(documentsPath());
+            if (countDocuments(log, index.documentsEnd()) >= kMergeThreshold) {
+                return mergeLocked();
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Function to fold all pending documents of the log into the index
+     *
+     * @return true on success
+     */
+    bool merge() {
+        if (!enabled()) {
+            return false;
+        }
+        lock_guard<mutex> lock(writeMutex_);
+        return mergeLocked();
+    }
+
+    /**
+     * Function to find the documents best matching a query
+     *
+     * @param query Free-text query; documents matching any term are ranked
+     * @param limit Maximum number of hits
+     * @param matchCount Receives the number of documents matching any term
+     * @return Hits ordered by descending BM25 score
+     */
+    vector<Hit> search(const string &query, size_t limit, size_t *matchCount = nullptr) const {
+        vector<Hit> hits;
+        if (!enabled()) {
+            return hits;
+        }
+        IndexView index(indexPath());
+        MappedFile log(documentsPath(), MADV_RANDOM);
+        PendingDocuments pending;
+        readPending(log, index.documentsEnd(), index.documentCount(), SIZE_MAX, pending);
+
+        uint64_t documentCount = index.documentCount() + pending.lengths.size();
+        if (documentCount == 0) {
+            return hits;
+        }
+        double averageLength = static_cast<double>(index.totalLength() + pending.totalLength) / documentCount;
+
+        vector<string> terms;
+        forEachSearchTerm(query.data(), query.size(), [&](const string &term) {
+            if (find(terms.begin(), terms.end(), term) == terms.end()) {
+                terms.push_back(term);
+            }
+        });
+
+        vector<float> scores(documentCount, 0.0f);
+        vector<uint32_t> matched;
+        for (const string &term : terms) {
+            TermEntry entry;
+            bool indexed = index.find(term, entry);
+            auto added = pending.postings.find(term);
+            uint64_t documentFrequency = (indexed ? entry.documentFrequency : 0)
+                                         + (added != pending.postings.end() ? added->second.size() : 0);
+            if (documentFrequency == 0) {
+                continue;
+            }
+            double idf = log1p((documentCount - documentFrequency + 0.5) / (documentFrequency + 0.5));
+            auto score = [&](uint32_t document, uint32_t frequency, uint32_t length) {
+                double weight = frequency * (kK1 + 1) / (frequency + kK1 * (1 - kB + kB * length / averageLength));
+                if (scores[document] == 0.0f) {
+                    matched.push_back(document);
+                }
+                scores[document] += static_cast<float>(idf * weight);
+            };
+
+            if (indexed) {
+                const char *cursor = index.postings(entry);
+                const char *end = cursor + entry.postingsLength;
+                uint32_t document = 0;
+                while (cursor < end) {
+                    document += readVarint(cursor, end);
+                    uint32_t frequency = readVarint(cursor, end);
+                    if (document >= index.documentCount()) {
+                        break;  // Corrupt posting list
+                    }
+                    score(document, frequency, index.documentLength(document));
+                }
+            }
+            if (added != pending.postings.end()) {
+                for (const auto &[document, frequency] : added->second) {
+                    score(document, frequency, pending.lengths[document - index.documentCount()]);
+                }
+            }
+        }
+        if (matchCount) {
+            *matchCount = matched.size();
+        }
+
+        auto better = [&](uint32_t a, uint32_t b) {
+            return scores[a] != scores[b] ? scores[a] > scores[b] : a < b;
+        };
+        size_t count = min(limit, matched.size());
+        partial_sort(matched.begin(), matched.begin() + count, matched.end(), better);
+        for (size_t i = 0; i < count; ++i) {
+            uint32_t document = matched[i];
+            uint64_t offset = document < index.documentCount() ? index.documentOffset(document)
+                                                                : pending.offsets[document - index.documentCount()];
+            string_view fields[3];
+            const char *cursor = log.data() + offset;
+            const char *end = log.data() + log.size();
+            if (offset < log.size() && readField(cursor, end, fields[0]) && readField(cursor, end, fields[1])
+                && readField(cursor, end, fields[2])) {
+                hits.push_back({document, scores[document], string(fields[0]), string(fields[1]), string(fields[2])});
+            }
+        }
+        return hits;
+    }
+
+    // Sources of all stored documents, used to skip files that are already indexed
+    set<string> sources() const {
+        set<string> result;
+        MappedFile log(documentsPath());
+        const char *cursor = log.data();
+        const char *end = cursor + log.size();
+        string_view title, source, snippet, text;
+        while (cursor && cursor < end && readField(cursor, end, title) && readField(cursor, end, source)
+               && readField(cursor, end, snippet) && readField(cursor, end, text)) {
+            result.emplace(source);
+        }
+        return result;
+    }
+
+private:
+    // Body of merge(); the caller holds writeMutex_
+    bool mergeLocked() {
+        MappedFile log(documentsPath());
+        while (true) {
+            IndexView index(indexPath());
+            if (!log.isOpen() || index.documentsEnd() >= log.size()) {
+                return true;
+            }
+            PendingDocuments pending;
+            readPending(log, index.documentsEnd(), index.documentCount(), kMergeBatch, pending);
+            if (pending.lengths.empty()) {
+                return true;  // Only a truncated record is left
+            }
+            if (!writeIndex(index, pending)) {
+                return false;
+            }
+        }
+    }
+
+    // BM25 term frequency saturation and length normalization
+    static constexpr double kK1 = 1.2;
+    static constexpr double kB = 0.75;
+
+    struct Header {
+        char magic[8];
+        uint64_t documentCount;
+        uint64_t termCount;
+        uint64_t totalLength;
+        uint64_t documentsEnd;
+        uint64_t lengthsOffset;
+        uint64_t offsetsOffset;
+        uint64_t termsOffset;
+        uint64_t termBytesOffset;
+        uint64_t postingsOffset;
+    };
+
+    struct TermEntry {
+        uint32_t termOffset;
+        uint32_t termLength;
+        uint64_t postingsOffset;
+        uint32_t postingsLength;
+        uint32_t documentFrequency;
+        uint32_t lastDocument;
+        uint32_t reserved;
+    };
+    static_assert(sizeof(TermEntry) == 32, "term entries are 32 bytes on disk");
+
+    // Read-only view of index.dat; a missing or invalid file reads as an empty index
+    class IndexView {
+    public:
+        explicit IndexView(const string &path) : mapped_(path, MADV_RANDOM) {
+            if (!mapped_.isOpen() || mapped_.size() < sizeof(Header)) {
+                return;
+            }
+            memcpy(&header_, mapped_.data(), sizeof(Header));
+            if (memcmp(header_.magic, "VRIDX001", 8) != 0 || header_.postingsOffset > mapped_.size()
+                || header_.termsOffset + header_.termCount * sizeof(TermEntry) > mapped_.size()) {
+                cerr << "Ignoring invalid search index: " << path << endl;
+                header_ = Header();
+                return;
+            }
+            valid_ = true;
+        }
+
+        uint64_t documentCount() const { return valid_ ? header_.documentCount : 0; }
+        uint64_t termCount() const { return valid_ ? header_.termCount : 0; }
+        uint64_t totalLength() const { return valid_ ? header_.totalLength : 0; }
+        uint64_t documentsEnd() const { return valid_ ? header_.documentsEnd : 0; }
+
+        uint32_t documentLength(uint64_t document) const {
+            return load<uint32_t>(header_.lengthsOffset + document * sizeof(uint32_t));
+        }
+
+        uint64_t documentOffset(uint64_t document) const {
+            return load<uint64_t>(header_.offsetsOffset + document * sizeof(uint64_t));
+        }
+
+        TermEntry term(uint64_t index) const {
+            return load<TermEntry>(header_.termsOffset + index * sizeof(TermEntry));
+        }
+
+        string_view termText(const TermEntry &entry) const {
+            return string_view(mapped_.data() + header_.termBytesOffset + entry.termOffset, entry.termLength);
+        }
+
+        const char *postings(const TermEntry &entry) const {
+            return mapped_.data() + header_.postingsOffset + entry.postingsOffset;
+        }
+
+        // Binary search of the sorted term table
+        bool find(string_view term, TermEntry &entry) const {
+            uint64_t low = 0;
+            uint64_t high = termCount();
+            while (low < high) {
+                uint64_t middle = low + (high - low) / 2;
+                TermEntry candidate = this->term(middle);
+                int order = termText(candidate).compare(term);
+                if (order == 0) {
+                    entry = candidate;
+                    return true;
+                }
+                if (order < 0) {
+                    low = middle + 1;
+                } else {
+                    high = middle;
+                }
+            }
+            return false;
+        }
+
+    private:
+        template <typename T>
+        T load(uint64_t offset) const {
+            T value;
+            memcpy(&value, mapped_.data() + offset, sizeof(T));
+            return value;
+        }
+
+        MappedFile mapped_;
+        Header header_ = Header();
+        bool valid_ = false;
+    };
+
+    // Documents of the log that are not in index.dat yet, tokenized in memory
+    struct PendingDocuments {
+        vector<uint64_t> offsets;
+        vector<uint32_t> lengths;
+        uint64_t totalLength = 0;
+        uint64_t end = 0;
+        unordered_map<string, vector<pair<uint32_t, uint32_t>>> postings;
+    };
+
+    TranscriptSearchIndex() {
+        const char *configured = getenv("VR_SEARCH_INDEX");
+        string directory = configured && *configured ? configured : "search";
+        if (directory == "off") {
+            return;
+        }
+        error_code ec;
+        std::filesystem::create_directories(directory, ec);
+        directory_ = directory;
+    }
+
+    string documentsPath() const {
+        return (std::filesystem::path(directory_) / "documents.dat").string();
+    }
+
+    string indexPath() const {
+        return (std::filesystem::path(directory_) / "index.dat").string();
+    }
+
+    static bool readField(const char *&cursor, const char *end, string_view &value) {
+        uint32_t length;
+        if (end - cursor < static_cast<ptrdiff_t>(sizeof(length))) {
+            return false;
+        }
+        memcpy(&length, cursor, sizeof(length));
+        cursor += sizeof(length);
+        if (end - cursor < static_cast<ptrdiff_t>(length)) {
+            return false;
+        }
+        value = string_view(cursor, length);
+        cursor += length;
+        return true;
+    }
+
+    static void appendVarint(string &output, uint32_t value) {
+        while (value >= 0x80) {
+            output += static_cast<char>(value | 0x80);
+            value >>= 7;
+        }
+        output += static_cast<char>(value);
+    }
+
+    static uint32_t readVarint(const char *&cursor, const char *end) {
+        uint32_t value = 0;
+        for (int shift = 0; cursor < end && shift < 35; shift += 7) {
+            unsigned char byte = *cursor++;
+            value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) {
+                break;
+            }
+        }
+        return value;
+    }
+
+    // Number of complete documents in the log after the given offset
+    static size_t countDocuments(const MappedFile &log, uint64_t offset) {
+        size_t count = 0;
+        if (!log.data() || offset >= log.size()) {
+            return 0;
+        }
+        const char *cursor = log.data() + offset;
+        const char *end = log.data() + log.size();
+        string_view field;
+        while (cursor < end && readField(cursor, end, field) && readField(cursor, end, field)
+               && readField(cursor, end, field) && readField(cursor, end, field)) {
+            ++count;
+        }
+        return count;
+    }
+
+    // Tokenize up to maxDocuments documents of the log, numbering them from firstDocument
+    static void readPending(const MappedFile &log, uint64_t offset, uint64_t firstDocument,
+                            size_t maxDocuments, PendingDocuments &pending) {
+        pending.end = offset;
+        if (!log.data() || offset >= log.size()) {
+            return;
+        }
+        const char *begin = log.data();
+        const char *cursor = begin + offset;
+        const char *end = begin + log.size();
+        unordered_map<string, uint32_t> frequencies;
+        while (cursor < end && pending.lengths.size() < maxDocuments) {
+            const char *record = cursor;
+            string_view title, source, snippet, text;
+            if (!readField(cursor, end, title) || !readField(cursor, end, source)
+                || !readField(cursor, end, snippet) || !readField(cursor, end, text)) {
+                break;  // Truncated trailing record
+            }
+            uint32_t document = firstDocument + pending.lengths.size();
+            uint32_t length = 0;
+            frequencies.clear();
+            auto count = [&](const string &term) {
+                ++frequencies[term];
+                ++length;
+            };
+            forEachSearchTerm(title.data(), title.size(), count);
+            forEachSearchTerm(text.data(), text.size(), count);
+            for (const auto &[term, frequency] : frequencies) {
+                pending.postings[term].push_back({document, frequency});
+            }
+            pending.offsets.push_back(record - begin);
+            pending.lengths.push_back(length);
+            pending.totalLength += length;
+            pending.end = cursor - begin;
+        }
+    }
+
+    // Write a new index.dat holding the old index followed by the pending documents
+    bool writeIndex(const IndexView &old, const PendingDocuments &pending) {
+        vector<const string*> newTerms;
+        newTerms.reserve(pending.postings.size());
+        for (const auto &entry : pending.postings) {
+            newTerms.push_back(&entry.first);
+        }
+        sort(newTerms.begin(), newTerms.end(), [](const string *a, const string *b) { return *a < *b; });
+
+        string terms, termBytes, postings;
+        auto appendTerm = [&](string_view term, const TermEntry *oldEntry,
+                              const vector<pair<uint32_t, uint32_t>> *added) {
+            TermEntry entry = TermEntry();
+            entry.termOffset = termBytes.size();
+            entry.termLength = term.size();
+            entry.postingsOffset = postings.size();
+            termBytes.append(term.data(), term.size());
+            uint32_t previous = 0;
+            if (oldEntry) {
+                postings.append(old.postings(*oldEntry), oldEntry->postingsLength);
+                entry.documentFrequency = oldEntry->documentFrequency;
+                entry.lastDocument = previous = oldEntry->lastDocument;
+            }
+            if (added) {
+                // Pending documents are numbered after every indexed one, so the lists just concatenate
+                for (const auto &[document, frequency] : *added) {
+                    appendVarint(postings, document - previous);
+                    appendVarint(postings, frequency);
+                    previous = document;
+                }
+                entry.documentFrequency += added->size();
+                entry.lastDocument = previous;
+            }
+            entry.postingsLength = postings.size() - entry.postingsOffset;
+            terms.append(reinterpret_cast<const char*>(&entry), sizeof(entry));
+        };
+
+        uint64_t oldIndex = 0;
+        size_t newIndex = 0;
+        while (oldIndex < old.termCount() || newIndex < newTerms.size()) {
+            TermEntry oldEntry;
+            int order;
+            if (oldIndex == old.termCount()) {
+                order = 1;
+            } else {
+                oldEntry = old.term(oldIndex);
+                order = newIndex == newTerms.size() ? -1 : old.termText(oldEntry).compare(*newTerms[newIndex]);
+            }
+            if (order < 0) {
+                appendTerm(old.termText(oldEntry), &oldEntry, nullptr);
+                ++oldIndex;
+            } else if (order > 0) {
+                appendTerm(*newTerms[newIndex], nullptr, &pending.postings.at(*newTerms[newIndex]));
+                ++newIndex;
+            } else {
+                appendTerm(old.termText(oldEntry), &oldEntry, &pending.postings.at(*newTerms[newIndex]));
+                ++oldIndex;
+                ++newIndex;
+            }
+        }
+
+        uint64_t documentCount = old.documentCount() + pending.lengths.size();
+        string lengths, offsets;
+        lengths.reserve(documentCount * sizeof(uint32_t));
+        offsets.reserve(documentCount * sizeof(uint64_t));
+        for (uint64_t document = 0; document < old.documentCount(); ++document) {
+            uint32_t length = old.documentLength(document);
+            uint64_t offset = old.documentOffset(document);
+            lengths.append(reinterpret_cast<const char*>(&length), sizeof(length));
+            offsets.append(reinterpret_cast<const char*>(&offset), sizeof(offset));
+        }
+        lengths.append(reinterpret_cast<const char*>(pending.lengths.data()), pending.lengths.size() * sizeof(uint32_t));
+        offsets.append(reinterpret_cast<const char*>(pending.offsets.data()), pending.offsets.size() * sizeof(uint64_t));
+        lengths.resize((lengths.size() + 7) & ~size_t(7), '\0');
+
+        Header header = Header();
+        memcpy(header.magic, "VRIDX001", 8);
+        header.documentCount = documentCount;
+        header.termCount = terms.size() / sizeof(TermEntry);
+        header.totalLength = old.totalLength() + pending.totalLength;
+        header.documentsEnd = pending.end;
+        header.lengthsOffset = sizeof(Header);
+        header.offsetsOffset = header.lengthsOffset + lengths.size();
+        header.termsOffset = header.offsetsOffset + offsets.size();
+        header.termBytesOffset = header.termsOffset + terms.size();
+        header.postingsOffset = header.termBytesOffset + termBytes.size();
+
+        // Replace the index atomically so concurrent readers see either version
+        string temporaryPath = indexPath() + ".tmp";
+        {
+            ofstream file(temporaryPath, ios::binary | ios::trunc);
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            for (const string *section : {&lengths, &offsets, &terms, &termBytes, &postings}) {
+                file.write(section->data(), section->size());
+            }
+            if (!file) {
+                cerr << "Failed to write search index: " << temporaryPath << endl;
+                return false;
+            }
+        }
+        error_code ec;
+        std::filesystem::rename(temporaryPath, indexPath(), ec);
+        if (ec) {
+            cerr << "Failed to replace search index: " << ec.message() << endl;
+            return false;
+        }
+        return true;
+    }
+
+    string directory_;
+    std::mutex writeMutex_;
+};
+
+/**
+ * Function to add a categorized result to the search index
+ * 
+ * @param data The categorized JSON
+ * @param transcript The transcript it was generated from (may be empty)
+ * @param source Path of the stored categorized JSON
+ * @param mergeWhenDue Passed on to TranscriptSearchIndex::add
+ * @return true if the document was stored
+ */
+bool indexForSearch(const json &data, const string &transcript, const string &source, bool mergeWhenDue = true) {
+    string title = data.contains("AI_Title") && data["AI_Title"].is_string() ? data["AI_Title"].get<string>() : "";
+    string snippet = data.contains("Summary") && data["Summary"].is_string() ? data["Summary"].get<string>() : "";
+    string text = transcript;
+    text += '\n';
+    for (const auto &[key, value] : data.items()) {
+        // The title is indexed on its own; counting it again in the text would weight it twice
+        if (key != "AI_Title") {
+            appendSearchText(value, text);
+        }
+    }
+    return TranscriptSearchIndex::instance().add(title, source, snippet, text, mergeWhenDue);
+}
+
+/**
+ * Function to add stored categorized JSON files to the search index
+ * 
+ * Files that are already indexed are skipped, so the command can be re-run after
+ * new results were stored.
+ * 
+ * @param inputDir Directory containing categorized JSON files
+ * @return true if every new file was indexed
+ */
+bool indexCategorizedJson(const string &inputDir) {
+    namespace fs = std::filesystem;
+    TranscriptSearchIndex &searchIndex = TranscriptSearchIndex::instance();
+    if (!searchIndex.enabled()) {
+        cerr << "The search index is disabled (VR_SEARCH_INDEX=off)" << endl;
+        return false;
+    }
+
+    error_code ec;
+    set<string> indexed = searchIndex.sources();
+    vector<fs::path> inputFiles;
+    for (fs::directory_iterator it(inputDir, ec), end; !ec && it != end; it.increment(ec)) {
+        if (it->is_regular_file() && it->path().extension() == ".json" && !indexed.count(it->path().string())) {
+            inputFiles.push_back(it->path());
+        }
+    }
+    if (ec) {
+        cerr << "Failed to read input directory " << inputDir << ": " << ec.message() << endl;
+        return false;
+    }
+    sort(inputFiles.begin(), inputFiles.end());
+
+    auto startTime = chrono::steady_clock::now();
+    size_t failures = 0;
+    JobArena arena;
+    for (const auto &inputPath : inputFiles) {
+        MappedFile mapped(inputPath.string());
+        bool stored = false;
+        if (mapped.isOpen()) {
+            JobArenaScope arenaScope(arena);
+            try {
+                json data = json::parse(mapped.data(), mapped.data() + mapped.size());
+                stored = indexForSearch(data, "", inputPath.string(), false);
+            } catch (const exception &e) {
+                cerr << "Failed to index " << inputPath.string() << ": " << e.what() << endl;
+            }
+        }
+        arena.reset();
+        failures += stored ? 0 : 1;
+    }
+    bool merged = searchIndex.merge();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+    cout << "Indexed " << inputFiles.size() - failures << " of " << inputFiles.size() << " new files in "
+         << fixed << setprecision(2) << seconds << "s (" << indexed.size() << " already indexed)" << endl;
+    return merged && failures == 0;
+}
+
+/**
+ * Function to search the indexed transcripts and print the ranked hits
+ * 
+ * @param query Free-text query
+ * @param limit Maximum number of hits to print
+ * @return true if the index could be searched
+ */
+bool searchTranscripts(const string &query, size_t limit) {
+    TranscriptSearchIndex &searchIndex = TranscriptSearchIndex::instance();
+    if (!searchIndex.enabled()) {
+        cerr << "The search index is disabled (VR_SEARCH_INDEX=off)" << endl;
+        return false;
+    }
+    auto startTime = chrono::steady_clock::now();
+    size_t matchCount = 0;
+    vector<TranscriptSearchIndex::Hit> hits = searchIndex.search(query, limit, &matchCount);
+    double milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+
+    for (size_t i = 0; i < hits.size(); ++i) {
+        const auto &hit = hits[i];
+        cout << setw(3) << i + 1 << ". " << fixed << setprecision(2) << hit.score << "  "
+             << (hit.title.empty() ? "(untitled)" : hit.title);
+        if (!hit.source.empty()) {
+            cout << "  [" << hit.source << "]";
+        }
+        cout << endl;
+        if (!hit.snippet.empty()) {
+            cout << "     " << (hit.snippet.size() > 160 ? hit.snippet.substr(0, 157) + "..." : hit.snippet) << endl;
+        }
+    }
+    cout << hits.size() << " of " << matchCount << " matching documents in "
+         << fixed << setprecision(2) << milliseconds << " ms" << endl;
+    return true;
+}
+
+/**
+ * Columnar archive of stored categorized results
+ * 
+ * Records are split into blocks of up to kBlockRecords. Within a block every top-level
+ * field (Summary, Main Points, Type, Duration (Seconds), AI Cost, Transcript, ...) is
+ * stored as its own zlib-compressed column chunk, and a footer indexes every chunk.
+ * Aggregate queries therefore only decompress the columns they read, and a single
+ * record only needs the chunks of its own block.
+ * 
+ * File layout (all integers little-endian):
+ *   "VRCOL001"
+ *   column chunks, each compressed separately:
+ *     number chunk: u8 kind per record, then f64 value per record
+ *     text chunk:   u8 kind per record, u32 length per record, then the bytes
+ *     (kinds: 0 absent, 1 string, 2 other JSON, 3 integer, 4 floating point;
+ *      strings are stored as is, other JSON values as JSON text)
+ *   footer: u32 column count, per column u32 name length and name;
+ *           u32 block count, per block u32 record count and per column
+ *           u8 encoding (0 absent, 1 number, 2 text), u64 offset,
+ *           u32 compressed size, u32 uncompressed size
+ *   trailer: u64 footer offset, "VRCOLEND"
+ */
+class ColumnarArchive {
+public:
+    enum Kind : uint8_t { kAbsent = 0, kString = 1, kJson = 2, kInteger = 3, kFloat = 4 };
+    enum Encoding : uint8_t { kNoChunk = 0, kNumberChunk = 1, kTextChunk = 2 };
+
+    static const size_t kBlockRecords = 1024;
+
+    template <typename T>
+    static void appendRaw(string &output, const T &value) {
+        output.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    static bool readRaw(const char *&cursor, const char *end, T &value) {
+        if (end - cursor < static_cast<ptrdiff_t>(sizeof(T))) {
+            return false;
+        }
+        memcpy(&value, cursor, sizeof(T));
+        cursor += sizeof(T);
+        return true;
+    }
+
+    /**
+     * Function to read a number from a value stored as text
+     * 
+     * The model sometimes returns amounts such as "$0.02" or durations as strings.
+     * 
+     * @param text The stored text
+     * @param value Receives the number
+     * @return true if the text holds a number
+     */
+    static bool parseNumber(string_view text, double &value) {
+        string digits(text);
+        size_t start = digits.find_first_not_of(" \"$");
+        if (start == string::npos) {
+            return false;
+        }
+        char *end = nullptr;
+        value = strtod(digits.c_str() + start, &end);
+        return end != digits.c_str() + start && !std::isnan(value);
+    }
+
+    /**
+     * Builds an archive file block by block
+     */
+    class Writer {
+    public:
+        explicit Writer(const string &path) : path_(path), file_(path, ios::binary | ios::trunc) {
+            file_.write("VRCOL001", 8);
+        }
+
+        bool isOpen() const {
+            return static_cast<bool>(file_);
+        }
+
+        // Append a record (a JSON object); fields seen for the first time become new columns
+        void add(const json &record) {
+            size_t row = blockSize_++;
+            for (const auto &[key, value] : record.items()) {
+                auto found = columnIndex_.find(key);
+                size_t column;
+                if (found == columnIndex_.end()) {
+                    column = columns_.size();
+                    columnIndex_[key] = column;
+                    columns_.emplace_back();
+                    columns_.back().name = key;
+                } else {
+                    column = found->second;
+                }
+                ColumnBuffer &buffer = columns_[column];
+                buffer.fill(row);
+                if (value.is_number_integer()) {
+                    buffer.push(kInteger, value.get<double>(), "");
+                } else if (value.is_number()) {
+                    buffer.push(kFloat, value.get<double>(), "");
+                } else if (value.is_string()) {
+                    buffer.push(kString, 0, value.get_ref<const string&>());
+                } else {
+                    buffer.push(kJson, 0, value.dump());
+                }
+            }
+            if (blockSize_ == kBlockRecords) {
+                flushBlock();
+            }
+        }
+
+        /**
+         * Function to write the last block and the footer
+         * 
+         * @return true if the whole archive was written
+         */
+        bool finish() {
+            if (blockSize_ > 0) {
+                flushBlock();
+            }
+            uint64_t footerOffset = static_cast<uint64_t>(file_.tellp());
+            string footer;
+            appendRaw<uint32_t>(footer, columns_.size());
+            for (const auto &column : columns_) {
+                appendRaw<uint32_t>(footer, column.name.size());
+                footer += column.name;
+            }
+            appendRaw<uint32_t>(footer, blocks_.size());
+            for (const auto &block : blocks_) {
+                appendRaw<uint32_t>(footer, block.records);
+                for (size_t column = 0; column < columns_.size(); ++column) {
+                    ChunkLocation chunk = column < block.chunks.size() ? block.chunks[column] : ChunkLocation();
+                    appendRaw(footer, chunk.encoding);
+                    appendRaw(footer, chunk.offset);
+                    appendRaw(footer, chunk.compressedSize);
+                    appendRaw(footer, chunk.size);
+                }
+            }
+            appendRaw(footer, footerOffset);
+            footer += "VRCOLEND";
+            file_.write(footer.data(), footer.size());
+            file_.close();
+            if (!file_) {
+                cerr << "Failed to write archive: " << path_ << endl;
+                return false;
+            }
+            return true;
+        }
+
+        size_t recordCount() const {
+            size_t count = blockSize_;
+            for (const auto &block : blocks_) {
+                count += block.records;
+            }
+            return count;
+        }
+
+    private:
+        struct ColumnBuffer {
+            string name;
+            vector<uint8_t> kinds;
+            vector<double> numbers;
+            vector<uint32_t> lengths;
+            string bytes;
+
+            // Mark records of this block that lacked the field as absent
+            void fill(size_t rows) {
+                while (kinds.size() < rows) {
+                    push(kAbsent, 0, "");
+                }
+            }
+
+            void push(Kind kind, double number, const string &text) {
+                kinds.push_back(kind);
+                numbers.push_back(kind == kInteger || kind == kFloat ? number : NAN);
+                lengths.push_back(text.size());
+                bytes += text;
+            }
+
+            void clear() {
+                kinds.clear();
+                numbers.clear();
+                lengths.clear();
+                bytes.clear();
+            }
+        };
+
+        struct ChunkLocation {
+            uint8_t encoding = kNoChunk;
+            uint64_t offset = 0;
+            uint32_t compressedSize = 0;
+            uint32_t size = 0;
+        };
+
+        struct Block {
+            uint32_t records;
+            vector<ChunkLocation> chunks;
+        };
+
+        void flushBlock() {
+            Block block{static_cast<uint32_t>(blockSize_), {}};
+            for (auto &column : columns_) {
+                column.fill(blockSize_);
+                bool present = false;
+                bool numeric = true;
+                for (uint8_t kind : column.kinds) {
+                    present |= kind != kAbsent;
+                    numeric &= kind == kAbsent || kind == kInteger || kind == kFloat;
+                }
+
+                ChunkLocation location;
+                if (present) {
+                    string chunk(reinterpret_cast<const char*>(column.kinds.data()), column.kinds.size());
+                    if (numeric) {
+                        location.encoding = kNumberChunk;
+                        chunk.append(reinterpret_cast<const char*>(column.numbers.data()), column.numbers.size() * sizeof(double));
+                    } else {
+                        // Numbers mixed into a text column are stored as JSON text
+                        string text;
+                        size_t position = 0;
+                        for (size_t row = 0; row < column.kinds.size(); ++row) {
+                            uint32_t length = column.lengths[row];
+                            if (column.kinds[row] == kInteger || column.kinds[row] == kFloat) {
+                                string number = column.kinds[row] == kInteger
+                                                ? to_string(static_cast<int64_t>(column.numbers[row]))
+                                                : json(column.numbers[row]).dump();
+                                length = number.size();
+                                text += number;
+                            } else {
+                                text.append(column.bytes, position, length);
+                                position += length;
+                            }
+                            appendRaw(chunk, length);
+                        }
+                        location.encoding = kTextChunk;
+                        chunk += text;
+                    }
+                    location.offset = static_cast<uint64_t>(file_.tellp());
+                    location.size = chunk.size();
+                    if (!writeCompressed(chunk, location.compressedSize)) {
+                        location = ChunkLocation();
+                    }
+                }
+                block.chunks.push_back(location);
+                column.clear();
+            }
+            blocks_.push_back(move(block));
+            blockSize_ = 0;
+        }
+
+        bool writeCompressed(const string &chunk, uint32_t &compressedSize) {
+            uLongf capacity = compressBound(chunk.size());
+            compressed_.resize(capacity);
+            if (compress2(reinterpret_cast<Bytef*>(compressed_.data()), &capacity,
+                          reinterpret_cast<const Bytef*>(chunk.data()), chunk.size(), Z_DEFAULT_COMPRESSION) != Z_OK) {
+                cerr << "Failed to compress archive column chunk" << endl;
+                return false;
+            }
+            file_.write(compressed_.data(), capacity);
+            compressedSize = capacity;
+            return static_cast<bool>(file_);
+        }
+
+        string path_;
+        ofstream file_;
+        vector<ColumnBuffer> columns_;
+        unordered_map<string, size_t> columnIndex_;
+        vector<Block> blocks_;
+        size_t blockSize_ = 0;
+        string compressed_;
+    };
+
+    /**
+     * Decompressed column chunk of one block
+     */
+    struct Chunk {
+        vector<uint8_t> kinds;
+        vector<double> numbers;
+        vector<string_view> texts;
+        string data;
+
+        size_t size() const {
+            return kinds.size();
+        }
+
+        // Numeric value of a record, also parsing numbers that were stored as text
+        bool number(size_t row, double &value) const {
+            if (kinds[row] == kInteger || kinds[row] == kFloat) {
+                value = numbers[row];
+                return true;
+            }
+            return (kinds[row] == kString || kinds[row] == kJson) && parseNumber(texts[row], value);
+        }
+
+        // Text of a record; numbers are formatted as JSON
+        string text(size_t row) const {
+            if (kinds[row] == kInteger) {
+                return to_string(static_cast<int64_t>(numbers[row]));
+            }
+            if (kinds[row] == kFloat) {
+                return json(numbers[row]).dump();
+            }
+            return string(texts[row]);
+        }
+
+        json value(size_t row) const {
+            switch (kinds[row]) {
+                case kString: return string(texts[row]);
+                case kJson: return json::parse(texts[row]);
+                case kInteger: return static_cast<int64_t>(numbers[row]);
+                case kFloat: return numbers[row];
+                default: return nullptr;
+            }
+        }
+    };
+
+    /**
+     * Memory-mapped archive reader
+     */
+    class Reader {
+    public:
+        explicit Reader(const string &path) : mapped_(path, MADV_RANDOM) {
+            const char *data = mapped_.data();
+            size_t size = mapped_.size();
+            uint64_t footerOffset;
+            if (!data || size < 32 || memcmp(data, "VRCOL001", 8) != 0 || memcmp(data + size - 8, "VRCOLEND", 8) != 0) {
+                return;
+            }
+            memcpy(&footerOffset, data + size - 16, sizeof(footerOffset));
+            if (footerOffset < 8 || footerOffset > size - 16) {
+                return;
+            }
+
+            const char *cursor = data + footerOffset;
+            const char *end = data + size - 16;
+            uint32_t columnCount, blockCount;
+            if (!readRaw(cursor, end, columnCount)) {
+                return;
+            }
+            for (uint32_t column = 0; column < columnCount; ++column) {
+                uint32_t length;
+                if (!readRaw(cursor, end, length) || end - cursor < static_cast<ptrdiff_t>(length)) {
+                    return;
+                }
+                columns_.emplace_back(cursor, length);
+                cursor += length;
+            }
+            if (!readRaw(cursor, end, blockCount)) {
+                return;
+            }
+            for (uint32_t block = 0; block < blockCount; ++block) {
+                Block entry;
+                if (!readRaw(cursor, end, entry.records)) {
+                    return;
+                }
+                entry.firstRecord = recordCount_;
+                recordCount_ += entry.records;
+                for (uint32_t column = 0; column < columnCount; ++column) {
+                    ChunkLocation chunk;
+                    if (!readRaw(cursor, end, chunk.encoding) || !readRaw(cursor, end, chunk.offset)
+                        || !readRaw(cursor, end, chunk.compressedSize) || !readRaw(cursor, end, chunk.size)
+                        || chunk.offset + chunk.compressedSize > footerOffset) {
+                        return;
+                    }
+                    entry.chunks.push_back(chunk);
+                }
+                blocks_.push_back(move(entry));
+            }
+            valid_ = true;
+        }
+
+        bool isOpen() const {
+            return valid_;
+        }
+
+        size_t recordCount() const {
+            return recordCount_;
+        }
+
+        size_t blockCount() const {
+            return blocks_.size();
+        }
+
+        const vector<string> &columns() const {
+            return columns_;
+        }
+
+        // Index of a column by field name, or -1
+        int columnIndex(const string &name) const {
+            auto found = find(columns_.begin(), columns_.end(), name);
+            return found == columns_.end() ? -1 : static_cast<int>(found - columns_.begin());
+        }
+
+        /**
+         * Function to decompress one column of one block
+         * 
+         * @param block Block index
+         * @param column Column index (-1 yields an all-absent chunk)
+         * @param chunk Receives the decoded values
+         * @return true on success
+         */
+        bool readChunk(size_t block, int column, Chunk &chunk) const {
+            const Block &entry = blocks_[block];
+            chunk.kinds.assign(entry.records, kAbsent);
+            chunk.numbers.assign(entry.records, NAN);
+            chunk.texts.assign(entry.records, string_view());
+            if (column < 0 || entry.chunks[column].encoding == kNoChunk) {
+                return true;
+            }
+            const ChunkLocation &location = entry.chunks[column];
+            chunk.data.resize(location.size);
+            uLongf size = location.size;
+            if (uncompress(reinterpret_cast<Bytef*>(chunk.data.data()), &size,
+                           reinterpret_cast<const Bytef*>(mapped_.data() + location.offset),
+                           location.compressedSize) != Z_OK || size != location.size) {
+                cerr << "Corrupt archive column chunk (" << columns_[column] << ", block " << block << ")" << endl;
+                return false;
+            }
+
+            const char *cursor = chunk.data.data();
+            const char *end = cursor + chunk.data.size();
+            if (end - cursor < static_cast<ptrdiff_t>(entry.records)) {
+                return false;
+            }
+            memcpy(chunk.kinds.data(), cursor, entry.records);
+            cursor += entry.records;
+            if (location.encoding == kNumberChunk) {
+                if (end - cursor < static_cast<ptrdiff_t>(entry.records * sizeof(double))) {
+                    return false;
+                }
+                memcpy(chunk.numbers.data(), cursor, entry.records * sizeof(double));
+                return true;
+            }
+            vector<uint32_t> lengths(entry.records);
+            for (uint32_t &length : lengths) {
+                if (!readRaw(cursor, end, length)) {
+                    return false;
+                }
+            }
+            for (size_t row = 0; row < entry.records; ++row) {
+                if (end - cursor < static_cast<ptrdiff_t>(lengths[row])) {
+                    return false;
+                }
+                if (chunk.kinds[row] == kInteger || chunk.kinds[row] == kFloat) {
+                    parseNumber(string_view(cursor, lengths[row]), chunk.numbers[row]);
+                } else {
+                    chunk.texts[row] = string_view(cursor, lengths[row]);
+                }
+                cursor += lengths[row];
+            }
+            return true;
+        }
+
+        /**
+         * Function to reconstruct a single record
+         * 
+         * Only the chunks of the block holding the record are decompressed.
+         * 
+         * @param index Record number (0-based, in archive order)
+         * @param record Receives the record as a JSON object
+         * @return true on success
+         */
+        bool readRecord(size_t index, json &record) const {
+            if (index >= recordCount_) {
+                return false;
+            }
+            auto block = upper_bound(blocks_.begin(), blocks_.end(), index,
+                                     [](size_t value, const Block &entry) { return value < entry.firstRecord; }) - 1;
+            size_t row = index - block->firstRecord;
+            record = json::object();
+            Chunk chunk;
+            for (size_t column = 0; column < columns_.size(); ++column) {
+                if (!readChunk(block - blocks_.begin(), column, chunk)) {
+                    return false;
+                }
+                if (chunk.kinds[row] != kAbsent) {
+                    try {
+                        record[columns_[column]] = chunk.value(row);
+                    } catch (const exception &e) {
+                        cerr << "Corrupt archive value in " << columns_[column] << ": " << e.what() << endl;
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+    private:
+        struct ChunkLocation {
+            uint8_t encoding;
+            uint64_t offset;
+            uint32_t compressedSize;
+            uint32_t size;
+        };
+
+        struct Block {
+            uint32_t records;
+            size_t firstRecord;
+            vector<ChunkLocation> chunks;
+        };
+
+        MappedFile mapped_;
+        vector<string> columns_;
+        vector<Block> blocks_;
+        size_t recordCount_ = 0;
+        bool valid_ = false;
+    };
+
+};
+
+/**
+ * Function to pack stored categorized JSON files into a columnar archive
+ * 
+ * Records are stored in file name order, which for saveCategorizedJson output is
+ * chronological order.
+ * 
+ * @param inputDir Directory containing categorized JSON files
+ * @param archivePath Path of the archive to create
+ * @return true if every file was archived
+ */
+bool buildArchive(const string &inputDir, const string &archivePath) {
+    namespace fs = std::filesystem;
+    error_code ec;
+    vector<fs::path> inputFiles;
+    for (fs::directory_iterator it(inputDir, ec), end; !ec && it != end; it.increment(ec)) {
+        if (it->is_regular_file() && it->path().extension() == ".json") {
+            inputFiles.push_back(it->path());
+        }
+    }
+    if (ec) {
+        cerr << "Failed to read input directory " << inputDir << ": " << ec.message() << endl;
+        return false;
+    }
+    sort(inputFiles.begin(), inputFiles.end());
+
+    ColumnarArchive::Writer writer(archivePath);
+    if (!writer.isOpen()) {
+        cerr << "Failed to open archive for writing: " << archivePath << endl;
+        return false;
+    }
+    auto startTime = chrono::steady_clock::now();
+    size_t failures = 0;
+    uint64_t inputBytes = 0;
+    JobArena arena;
+    for (const auto &inputPath : inputFiles) {
+        MappedFile mapped(inputPath.string());
+        {
+            JobArenaScope arenaScope(arena);
+            try {
+                json data = json::parse(mapped.data(), mapped.data() + mapped.size());
+                if (!data.is_object()) {
+                    throw runtime_error("not a JSON object");
+                }
+                writer.add(data);
+                inputBytes += mapped.size();
+            } catch (const exception &e) {
+                cerr << "Skipping " << inputPath.string() << ": " << e.what() << endl;
+                ++failures;
+            }
+        }
+        arena.reset();
+    }
+    if (!writer.finish()) {
+        return false;
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+    uint64_t archiveBytes = fs::file_size(archivePath, ec);
+    cout << "Archived " << writer.recordCount() << " records (" << inputBytes << " bytes of JSON) into "
+         << archivePath << " (" << archiveBytes << " bytes) in " << fixed << setprecision(2) << seconds << "s" << endl;
+    return failures == 0;
+}
+
+/**
+ * Function to print aggregate statistics of an archive
+ * 
+ * Totals the Duration (Seconds) and AI Cost columns overall and per Type. Only those
+ * three columns are decompressed.
+ * 
+ * @param archivePath Path of the archive
+ * @return true on success
+ */
+bool printArchiveStats(const string &archivePath) {
+    ColumnarArchive::Reader reader(archivePath);
+    if (!reader.isOpen()) {
+        cerr << "Not a valid archive: " << archivePath << endl;
+        return false;
+    }
+    auto startTime = chrono::steady_clock::now();
+    int typeColumn = reader.columnIndex("Type");
+    int durationColumn = reader.columnIndex("Duration (Seconds)");
+    int costColumn = reader.columnIndex("AI Cost");
+
+    struct Totals {
+        size_t records = 0;
+        double duration = 0;
+        double cost = 0;
+    };
+    Totals overall;
+    map<string, Totals> byType;
+    ColumnarArchive::Chunk types, durations, costs;
+    for (size_t block = 0; block < reader.blockCount(); ++block) {
+        if (!reader.readChunk(block, typeColumn, types) || !reader.readChunk(block, durationColumn, durations)
+            || !reader.readChunk(block, costColumn, costs)) {
+            return false;
+        }
+        for (size_t row = 0; row < types.size(); ++row) {
+            Totals &totals = byType[types.kinds[row] == ColumnarArchive::kAbsent ? "(none)" : types.text(row)];
+            double value;
+            ++totals.records;
+            if (durations.number(row, value)) {
+                totals.duration += value;
+            }
+            if (costs.number(row, value)) {
+                totals.cost += value;
+            }
+        }
+    }
+    for (const auto &[type, totals] : byType) {
+        overall.records += totals.records;
+        overall.duration += totals.duration;
+        overall.cost += totals.cost;
+    }
+    double milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+
+    auto printRow = [](const string &label, const Totals &totals) {
+        cout << left << setw(28) << label << right << setw(10) << totals.records
+             << setw(16) << fixed << setprecision(0) << totals.duration
+             << setw(14) << setprecision(2) << totals.cost << endl;
+    };
+    cout << left << setw(28) << "Type" << right << setw(10) << "Records" << setw(16) << "Duration (s)"
+         << setw(14) << "AI Cost" << endl;
+    for (const auto &[type, totals] : byType) {
+        printRow(type, totals);
+    }
+    printRow("Total", overall);
+    cout << "Aggregated " << reader.recordCount() << " records in " << setprecision(2) << milliseconds << " ms" << endl;
+    return true;
+}
+
+/**
+ * Function to print one record of an archive as JSON
+ * 
+ * @param archivePath Path of the archive
+ * @param index Record number (0-based)
+ * @return true if the record exists
+ */
+bool printArchiveRecord(const string &archivePath, size_t index) {
+    ColumnarArchive::Reader reader(archivePath);
+    if (!reader.isOpen()) {
+        cerr << "Not a valid archive: " << archivePath << endl;
+        return false;
+    }
+    json record;
+    if (!reader.readRecord(index, record)) {
+        cerr << "No record " << index << " in " << archivePath << " (" << reader.recordCount() << " records)" << endl;
+        return false;
+    }
+    cout << record.dump(2) << endl;
+    return true;
+}
+
+/**
+ * A categorized result on its way to the configured sinks
+ * 
+ * Built once per recording and shared read-only by every sink. Its JSON documents are
+ * allocated on the heap, not in the job's arena, because sinks deliver them after the
+ * job has finished.
+ */
+struct CategorizedResult {
+    string audioPath;
+    // Categorized JSON as sent to Notion and rendered to reports
+    json data;
+    // The stored JSON (categorized fields and transcript) and where it was saved
+    json storedData;
+    string jsonPath;
+    string latexPath;
+    string notionDatabaseId;
+    // Context of that database, resolved once for the job (see NotionDatabaseRegistry)
+    NotionDatabaseRegistry::ContextFuture notionDatabase;
+    // ID of the page to leave as it is, for a recording already in Notion
+    string existingNotionPageId;
+    // ID of the page created early with the basic metadata, empty if that failed
+    shared_future<string> earlyNotionPage;
+    // Called by the Notion sink with the ID of the page holding the result (empty on failure)
+    function<void(const string &notionPageId)> notionPageReady;
+    // Deadline of the job, which also bounds the sinks' requests
+    RequestTimeouts::Clock::time_point deadline = RequestTimeouts::Clock::time_point::max();
+    // Called by the Notion sink when its host's circuit breaker refused the result, with the
+    // ID of the page to fill in on the retry (empty if none was created)
+    function<void(const string &notionPageId)> parkForRetry;
+    // Park the result on any failed Notion delivery, not only a refused one (for resumed jobs)
+    bool parkOnFailure = false;
+};
+
+/**
+ * Destination of categorized results
+ * 
+ * deliver() is called on the sink's own worker threads, concurrency() of them at once.
+ */
+class ResultSink {
+public:
+    virtual ~ResultSink() = default;
+
+    virtual const char *name() const = 0;
+
+    // Number of results delivered at the same time
+    virtual size_t concurrency() const {
+        return 1;
+    }
+
+    /**
+     * Function to deliver one result
+     * 
+     * @param result The result
+     * @return true if the result was delivered
+     */
+    virtual bool deliver(const CategorizedResult &result) = 0;
+};
+
+/**
+ * Sink filling in the Notion page of a result, or creating it if the early page failed
+ */
+class NotionResultSink : public ResultSink {
+public:
+    NotionResultSink(const string &notionApiKey, size_t concurrency)
+        : notionApiKey_(notionApiKey), concurrency_(max<size_t>(1, concurrency)) {}
+
+    const char *name() const override {
+        return "notion";
+    }
+
+    // Notion requests spend their time waiting on the network
+    size_t concurrency() const override {
+        return concurrency_;
+    }
+
+    bool deliver(const CategorizedResult &result) override {
+        CircuitBreakers::refusedOnThisThread() = false;
+        string notionPageId = result.existingNotionPageId;
+        bool delivered = true;
+        bool refused = false;
+        shared_ptr<const NotionDatabaseContext> database;
+        if (notionPageId.empty()) {
+            database = (result.notionDatabase.valid()
+                            ? result.notionDatabase
+                            : NotionDatabaseRegistry::instance().context(result.notionDatabaseId, notionApiKey_)).get();
+        }
+        if (!notionPageId.empty()) {
+            cout << "Recording is already in Notion as page " << notionPageId << ", skipping upload" << endl;
+        } else if (!database) {
+            // The schema is loaded on another thread, so a refusal shows in the breaker's state
+            cerr << "Failed to ensure database properties" << endl;
+            notionPageId = result.earlyNotionPage.valid() ? result.earlyNotionPage.get() : "";
+            delivered = false;
+            refused = CircuitBreakers::instance().isOpen(notionBaseUrl());
+        } else if (result.earlyNotionPage.valid() && !(notionPageId = result.earlyNotionPage.get()).empty()) {
+            // Fill in the categorized properties of the page created with the basic metadata
+            delivered = updateNotionPage(result.data, *database, notionPageId, notionApiKey_);
+            if (delivered) {
+                cout << "Data successfully sent to Notion." << endl;
             } else {
-                // Try to convert string to number
-                try {
-                    double numValue = stod(value.is_string() ? value.get<string>() : value.dump());
-                    properties[propName] = {{"number", numValue}};
-                } catch (...) {
-                    properties[propName] = {{"number", nullptr}};
-                }
+                cerr << "Failed to update Notion page " << notionPageId << " with the categorized data." << endl;
             }
-        } else if (key == "Duration (Seconds)") {
-            // Duration (Seconds) is a number property
-            if (value.is_number()) {
-                properties[key] = {{"number", value}};
+        } else {
+            delivered = sendToNotion(result.data, *database, notionApiKey_, &notionPageId);
+            if (delivered) {
+                cout << "Data successfully sent to Notion." << endl;
             } else {
-                // Try to convert string to number
-                try {
-                    double numValue = stod(value.is_string() ? value.get<string>() : value.dump());
-                    properties[key] = {{"number", numValue}};
-                } catch (...) {
-                    properties[key] = {{"number", 0}};
-                }
+                cerr << "Failed to send data to Notion." << endl;
             }
-        } else if (key == "Date") {
-            // Date is a date property
-            if (value.is_null()) {
-                properties[key] = {{"date", nullptr}};
+        }
+        if (result.notionPageReady) {
+            // A page that could not be filled in does not hold the result
+            result.notionPageReady(delivered ? notionPageId : string());
+        }
+        // Notion is down: retry the delivery later rather than leave the result out of Notion
+        refused = refused || CircuitBreakers::refusedOnThisThread();
+        if (!delivered && (refused || result.parkOnFailure) && result.parkForRetry) {
+            result.parkForRetry(notionPageId);
+        }
+        return delivered;
+    }
+
+private:
+    string notionApiKey_;
+    size_t concurrency_;
+};
+
+/**
+ * Sink rendering each result as a LaTeX report at the result's latexPath
+ */
+class LatexResultSink : public ResultSink {
+public:
+    const char *name() const override {
+        return "latex";
+    }
+
+    bool deliver(const CategorizedResult &result) override {
+        if (!saveLatexToFile(result.data, result.latexPath, buffer_)) {
+            cerr << "Failed to save LaTeX output." << endl;
+            return false;
+        }
+        cout << "LaTeX output saved to " << result.latexPath << endl;
+        return true;
+    }
+
+private:
+    string buffer_;
+};
+
+/**
+ * Sink appending the stored JSON of each result as one line of a JSON Lines file
+ */
+class JsonlResultSink : public ResultSink {
+public:
+    explicit JsonlResultSink(const string &path) : path_(path) {}
+
+    const char *name() const override {
+        return "jsonl";
+    }
+
+    bool deliver(const CategorizedResult &result) override {
+        string line = result.storedData.dump();
+        line += '\n';
+        ofstream file(path_, ios::app);
+        file.write(line.data(), line.size());
+        if (!file.flush()) {
+            cerr << "Failed to append result to " << path_ << endl;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    string path_;
+};
+
+/**
+ * Sink writing each result as a Markdown note, with the sections of the LaTeX report
+ */
+class MarkdownResultSink : public ResultSink {
+public:
+    explicit MarkdownResultSink(const string &directory) : directory_(directory) {}
+
+    const char *name() const override {
+        return "markdown";
+    }
+
+    bool deliver(const CategorizedResult &result) override {
+        const json &data = result.data;
+        string markdown = "# ";
+        auto title = data.find("AI_Title");
+        markdown += title != data.end() ? text(*title) : std::filesystem::path(result.audioPath).stem().string();
+        markdown += "\n\n";
+        auto summary = data.find("Summary");
+        if (summary != data.end()) {
+            markdown += text(*summary) + "\n\n";
+        }
+        for (const auto &row : kLatexMetadataRows) {
+            auto value = data.find(row.key);
+            if (value == data.end() && row.fallbackKey) {
+                value = data.find(row.fallbackKey);
+            }
+            if (value != data.end()) {
+                markdown += string("- **") + row.label + ":** " + text(*value) + "\n";
+            }
+        }
+        for (const auto &section : kLatexSections) {
+            auto value = data.find(section.key);
+            if (value == data.end() || ((value->is_array() || value->is_object()) && value->empty())) {
+                continue;
+            }
+            markdown += string("\n## ") + section.key + "\n\n";
+            if (value->is_array()) {
+                for (const auto &item : *value) {
+                    markdown += "- " + text(item) + "\n";
+                }
+            } else if (value->is_object()) {
+                for (const auto &[key, item] : value->items()) {
+                    markdown += "- **" + key + ":** " + text(item) + "\n";
+                }
             } else {
-                string dateStr = value.is_string() ? value.get<string>() : value.dump();
-                if (dateStr == "null" || dateStr.empty()) {
-                    properties[key] = {{"date", nullptr}};
-                } else {
-                    properties[key] = {{"date", {{"start", dateStr}}}};
+                markdown += text(*value) + "\n";
+            }
+        }
+
+        error_code ec;
+        std::filesystem::create_directories(directory_, ec);
+        string stem = std::filesystem::path(result.jsonPath.empty() ? result.latexPath : result.jsonPath).stem().string();
+        string filePath = (std::filesystem::path(directory_) / (stem + ".md")).string();
+        ofstream file(filePath);
+        file << markdown;
+        if (!file.flush()) {
+            cerr << "Failed to write Markdown note: " << filePath << endl;
+            return false;
+        }
+        cout << "Markdown note saved to " << filePath << endl;
+        return true;
+    }
+
+private:
+    static string text(const json &value) {
+        return value.is_string() ? value.get<string>() : value.dump();
+    }
+
+    string directory_;
+};
+
+/**
+ * Fan-out of categorized results to every configured sink
+ * 
+ * Each sink has its own bounded queue and worker threads, so a slow sink (typically
+ * Notion) never holds up the others: the LaTeX report is written while the Notion
+ * request is still in flight. dispatch() only blocks when a sink's queue is full,
+ * which throttles the jobs producing results to the pace of the slowest sink.
+ * 
+ * Sinks are configured with VR_SINKS, a comma-separated list of "notion[:requests]"
+ * (default 4 requests at once, about Notion's rate limit), "latex",
+ * "jsonl[:path]" (default results.jsonl) and "markdown[:dir]" (default notes);
+ * the default is "notion,latex". VR_SINK_QUEUE sets the queue length per sink.
+ */
+class SinkDispatcher {
+public:
+    struct SinkStats {
+        string name;
+        size_t delivered;
+        size_t failed;
+        size_t maxQueued;
+    };
+
+    // Results waiting per sink before dispatch() blocks
+    static const size_t kDefaultQueueCapacity = 64;
+    // Notion requests in flight at once
+    static const size_t kDefaultNotionRequests = 4;
+
+    static SinkDispatcher &instance() {
+        static SinkDispatcher dispatcher;
+        return dispatcher;
+    }
+
+    bool hasSink(const string &name) const {
+        for (const auto &lane : lanes_) {
+            if (lane->sink->name() == name) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Function to queue a result for every sink
+     * 
+     * @param result The result; shared by the sinks until the last one is done
+     * @param sinkName Name of the only sink to queue it for, or empty for every sink
+     */
+    void dispatch(shared_ptr<const CategorizedResult> result, const string &sinkName = "") {
+        for (auto &lane : lanes_) {
+            if (!sinkName.empty() && lane->sink->name() != sinkName) {
+                continue;
+            }
+            unique_lock<mutex> lock(lane->mutex);
+            lane->notFull.wait(lock, [&lane, this] { return lane->queue.size() < capacity_; });
+            lane->queue.push_back(result);
+            lane->maxQueued = max(lane->maxQueued, lane->queue.size());
+            lane->notEmpty.notify_one();
+        }
+    }
+
+    /**
+     * Function to wait until every queued result has been delivered
+     * 
+     * @return true if no delivery has failed so far
+     */
+    bool drain() {
+        bool succeeded = true;
+        for (auto &lane : lanes_) {
+            unique_lock<mutex> lock(lane->mutex);
+            lane->idle.wait(lock, [&lane] { return lane->queue.empty() && lane->active == 0; });
+            succeeded = succeeded && lane->failed == 0;
+        }
+        return succeeded;
+    }
+
+    vector<SinkStats> stats() const {
+        vector<SinkStats> result;
+        for (const auto &lane : lanes_) {
+            lock_guard<mutex> lock(lane->mutex);
+            result.push_back({lane->sink->name(), lane->delivered, lane->failed, lane->maxQueued});
+        }
+        return result;
+    }
+
+    ~SinkDispatcher() {
+        for (auto &lane : lanes_) {
+            {
+                lock_guard<mutex> lock(lane->mutex);
+                lane->stopping = true;
+            }
+            lane->notEmpty.notify_all();
+            for (thread &worker : lane->workers) {
+                worker.join();
+            }
+        }
+    }
+
+private:
+    struct Lane {
+        unique_ptr<ResultSink> sink;
+        deque<shared_ptr<const CategorizedResult>> queue;
+        mutable std::mutex mutex;
+        condition_variable notEmpty;
+        condition_variable notFull;
+        condition_variable idle;
+        vector<thread> workers;
+        size_t active = 0;
+        size_t delivered = 0;
+        size_t failed = 0;
+        size_t maxQueued = 0;
+        bool stopping = false;
+    };
+
+    SinkDispatcher() {
+        const char *queue = getenv("VR_SINK_QUEUE");
+        capacity_ = queue && strtoul(queue, nullptr, 10) > 0 ? strtoul(queue, nullptr, 10) : kDefaultQueueCapacity;
+
+        const char *configured = getenv("VR_SINKS");
+        stringstream list(configured && *configured ? configured : "notion,latex");
+        string entry;
+        while (getline(list, entry, ',')) {
+            size_t colon = entry.find(':');
+            string name = entry.substr(0, colon);
+            string argument = colon == string::npos ? "" : entry.substr(colon + 1);
+            unique_ptr<ResultSink> sink;
+            if (name == "notion") {
+                size_t workers = argument.empty() ? kDefaultNotionRequests : strtoul(argument.c_str(), nullptr, 10);
+                sink = make_unique<NotionResultSink>(NOTION_API_KEY, workers);
+            } else if (name == "latex") {
+                sink = make_unique<LatexResultSink>();
+            } else if (name == "jsonl") {
+                sink = make_unique<JsonlResultSink>(argument.empty() ? "results.jsonl" : argument);
+            } else if (name == "markdown") {
+                sink = make_unique<MarkdownResultSink>(argument.empty() ? "notes" : argument);
+            } else if (!name.empty()) {
+                cerr << "Ignoring unknown result sink: " << name << endl;
+            }
+            if (sink) {
+                auto lane = make_unique<Lane>();
+                lane->sink = move(sink);
+                lanes_.push_back(move(lane));
+            }
+        }
+        for (auto &lane : lanes_) {
+            for (size_t worker = 0; worker < lane->sink->concurrency(); ++worker) {
+                lane->workers.emplace_back([this, lanePointer = lane.get()] { run(*lanePointer); });
+            }
+        }
+    }
+
+    void run(Lane &lane) {
+        while (true) {
+            shared_ptr<const CategorizedResult> result;
+            {
+                unique_lock<mutex> lock(lane.mutex);
+                lane.notEmpty.wait(lock, [&lane] { return lane.stopping || !lane.queue.empty(); });
+                if (lane.queue.empty()) {
+                    return;
                 }
+                result = move(lane.queue.front());
+                lane.queue.pop_front();
+                ++lane.active;
+                lane.notFull.notify_one();
+            }
+            bool delivered;
+            {
+                DeadlineScope deadline(result->deadline);
+                delivered = lane.sink->deliver(*result);
+            }
+            result.reset();
+            lock_guard<mutex> lock(lane.mutex);
+            --lane.active;
+            ++(delivered ? lane.delivered : lane.failed);
+            if (lane.queue.empty() && lane.active == 0) {
+                lane.idle.notify_all();
+            }
+        }
+    }
+
+    size_t capacity_;
+    vector<unique_ptr<Lane>> lanes_;
+};
+
+/**
+ * Priority class of a job
+ * 
+ * An interactive job (a fresh note someone is waiting for) should overtake a backlog
+ * of bulk jobs at every API-bound stage, without starving the backlog.
+ */
+enum class JobPriority { Interactive, Normal, Bulk };
+
+static const char *const kJobPriorityNames[] = {"interactive", "normal", "bulk"};
+
+// Share of the stage capacity each class receives while all of them are waiting
+static const double kJobPriorityWeights[] = {16.0, 4.0, 1.0};
+
+/**
+ * Function to parse the name of a priority class
+ * 
+ * @param name "interactive", "normal" or "bulk"
+ * @param priority Receives the class
+ * @return false if the name is unknown
+ */
+bool parseJobPriority(const string &name, JobPriority &priority) {
+    for (size_t index = 0; index < 3; ++index) {
+        if (name == kJobPriorityNames[index]) {
+            priority = static_cast<JobPriority>(index);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Weighted fair queuing of jobs at an API-bound pipeline stage
+ * 
+ * A stage (transcription, categorization) runs at most a fixed number of requests at
+ * once. When it is saturated, waiting jobs are admitted in order of their virtual
+ * finish time (self-clocked fair queuing): each request is tagged with
+ * start + cost / weight, where start is the later of the stage's virtual clock and
+ * the previous tag of the same class. A class thus receives capacity in proportion to
+ * its weight, and a cheap interactive request is admitted ahead of the bulk backlog
+ * queued before it, while bulk jobs keep making progress.
+ * 
+ * The number of requests in flight is set per stage with VR_TRANSCRIPTION_CONCURRENCY
+ * and VR_CATEGORIZATION_CONCURRENCY (default 4 each). Local transcriptions and
+ * categorizations, which use every core, run VR_LOCAL_TRANSCRIPTION_CONCURRENCY and
+ * VR_LOCAL_CATEGORIZATION_CONCURRENCY at a time (default 1 each).
+ * 
+ * The wait does not count against the job's deadline, which is postponed by it.
+ */
+class StageScheduler {
+public:
+    struct ClassStats {
+        size_t admitted = 0;
+        double totalWaitMs = 0;
+        double maxWaitMs = 0;
+    };
+
+    /**
+     * A request admitted to the stage; releases its place when destroyed
+     */
+    class Slot {
+    public:
+        explicit Slot(StageScheduler &stage) : stage_(&stage) {}
+        Slot(Slot &&other) noexcept : stage_(other.stage_) {
+            other.stage_ = nullptr;
+        }
+        Slot(const Slot&) = delete;
+        Slot& operator=(const Slot&) = delete;
+        Slot& operator=(Slot&&) = delete;
+
+        ~Slot() {
+            if (stage_) {
+                stage_->release();
             }
+        }
+
+    private:
+        StageScheduler *stage_;
+    };
+
+    static const size_t kDefaultConcurrency = 4;
+
+    static StageScheduler &transcription() {
+        static StageScheduler stage("transcription", "VR_TRANSCRIPTION_CONCURRENCY");
+        return stage;
+    }
+
+    static StageScheduler &categorization() {
+        static StageScheduler stage("categorization", "VR_CATEGORIZATION_CONCURRENCY");
+        return stage;
+    }
+
+    static StageScheduler &localTranscription() {
+        static StageScheduler stage("local transcription", "VR_LOCAL_TRANSCRIPTION_CONCURRENCY", 1);
+        return stage;
+    }
+
+    static StageScheduler &localCategorization() {
+        static StageScheduler stage("local categorization", "VR_LOCAL_CATEGORIZATION_CONCURRENCY", 1);
+        return stage;
+    }
+
+    /**
+     * Function to wait until the stage admits a request
+     * 
+     * @param priority Class of the job
+     * @param cost Expected work of the request (e.g. audio seconds or prompt tokens)
+     * @return The admitted slot
+     */
+    Slot acquire(JobPriority priority, double cost) {
+        auto waitStart = chrono::steady_clock::now();
+        size_t priorityClass = static_cast<size_t>(priority);
+        unique_lock<mutex> lock(mutex_);
+        double start = max(virtualTime_, lastFinish_[priorityClass]);
+        double finish = start + max(cost, 1.0) / kJobPriorityWeights[priorityClass];
+        lastFinish_[priorityClass] = finish;
+
+        if (active_ < capacity_ && waiting_.empty()) {
+            ++active_;
+            virtualTime_ = finish;
         } else {
-            // All other properties are rich_text
-            if (value.is_array()) {
-                // Convert array to string without square brackets
-                ostringstream contentStream;
-                for (size_t i = 0; i < value.size(); ++i) {
-                    string itemText = value[i].is_string() ? value[i].get<string>() : value[i].dump();
-                    contentStream << itemText;
-                    if (i < value.size() - 1) {
-                        contentStream << ", ";
-                    }
-                }
-                string content = contentStream.str();
-                properties[key] = {
-                    {"rich_text", nlohmann::json::array({
-                        {{"text", {{"content", content}}}}
-                    })}
-                };
-            } else {
-                // Handle non-array values as before
-                string content = value.is_string() ? value.get<string>() : value.dump();
-                properties[key] = {
-                    {"rich_text", nlohmann::json::array({
-                        {{"text", {{"content", content}}}}
-                    })}
-                };
+            auto ticket = waiting_.insert({{finish, nextSequence_++}, false}).first;
+            admitted_.wait(lock, [&ticket] { return ticket->second; });
+            waiting_.erase(ticket);
+        }
+
+        auto waited = chrono::steady_clock::now() - waitStart;
+        RequestTimeouts::postponeCurrentDeadline(waited);
+        double waitedMs = chrono::duration<double, milli>(waited).count();
+        ClassStats &stats = stats_[priorityClass];
+        ++stats.admitted;
+        stats.totalWaitMs += waitedMs;
+        stats.maxWaitMs = max(stats.maxWaitMs, waitedMs);
+        return Slot(*this);
+    }
+
+    const char *name() const {
+        return name_;
+    }
+
+    ClassStats stats(JobPriority priority) const {
+        lock_guard<mutex> lock(mutex_);
+        return stats_[static_cast<size_t>(priority)];
+    }
+
+private:
+    StageScheduler(const char *name, const char *variable, size_t defaultCapacity = kDefaultConcurrency)
+        : name_(name) {
+        const char *configured = getenv(variable);
+        size_t capacity = configured ? strtoul(configured, nullptr, 10) : 0;
+        capacity_ = capacity > 0 ? capacity : defaultCapacity;
+    }
+
+    void release() {
+        lock_guard<mutex> lock(mutex_);
+        // Hand the place straight to the waiting request with the earliest finish tag
+        for (auto &waiter : waiting_) {
+            if (!waiter.second) {
+                waiter.second = true;
+                virtualTime_ = waiter.first.first;
+                admitted_.notify_all();
+                return;
             }
         }
+        --active_;
+    }
+
+    const char *name_;
+    size_t capacity_;
+    size_t active_ = 0;
+    double virtualTime_ = 0;
+    double lastFinish_[3] = {0, 0, 0};
+    uint64_t nextSequence_ = 0;
+    // Waiting requests by (finish tag, arrival), and whether each has been admitted
+    map<pair<double, uint64_t>, bool> waiting_;
+    ClassStats stats_[3];
+    mutable std::mutex mutex_;
+    condition_variable admitted_;
+};
+
+// Typical bitrate of compressed voice recordings, used to estimate their length from their size
+const double kCompressedAudioBytesPerSecond = 16000;
+
+/**
+ * Process-wide budget for the memory held by jobs in flight
+ * 
+ * Before a job decodes and uploads its audio, it reserves its estimated peak memory
+ * (see estimateJobMemory). A job that does not fit waits until running jobs release
+ * theirs; waiting jobs are admitted in priority order, then in order of arrival, so a
+ * large job is not starved by a stream of small ones. A job larger than the whole
+ * budget runs alone. Together with streamed uploads and capped, spilling response
+ * buffers, this keeps the process within VR_MEMORY_BUDGET_MB (default 1024, "off"
+ * for no limit) under any load.
+ */
+class MemoryBudget {
+public:
+    /**
+     * Memory reserved for a job; released when destroyed
+     */
+    class Reservation {
+    public:
+        Reservation(MemoryBudget &budget, size_t bytes) : budget_(&budget), bytes_(bytes) {}
+        Reservation(Reservation &&other) noexcept : budget_(other.budget_), bytes_(other.bytes_) {
+            other.budget_ = nullptr;
+        }
+        Reservation(const Reservation&) = delete;
+        Reservation& operator=(const Reservation&) = delete;
+        Reservation& operator=(Reservation&&) = delete;
+
+        ~Reservation() {
+            if (budget_ && bytes_ > 0) {
+                budget_->release(bytes_);
+            }
+        }
+
+    private:
+        MemoryBudget *budget_;
+        size_t bytes_;
+    };
+
+    static MemoryBudget &instance() {
+        static MemoryBudget budget;
+        return budget;
+    }
+
+    /**
+     * Function to wait until a job's memory fits in the budget and reserve it
+     * 
+     * @param bytes Estimated peak memory of the job
+     * @param priority Class of the job
+     * @return The reservation
+     */
+    Reservation reserve(size_t bytes, JobPriority priority) {
+        if (budget_ == 0) {
+            return Reservation(*this, 0);
+        }
+        bytes = min(bytes, budget_);
+        unique_lock<mutex> lock(mutex_);
+        auto ticket = waiting_.insert({static_cast<size_t>(priority), nextSequence_++}).first;
+        auto admissible = [this, &ticket, bytes] { return ticket == waiting_.begin() && reserved_ + bytes <= budget_; };
+        if (!admissible()) {
+            ++waitedJobs_;
+            changed_.wait(lock, admissible);
+        }
+        waiting_.erase(ticket);
+        reserved_ += bytes;
+        peakReserved_ = max(peakReserved_, reserved_);
+        // The next job in line may fit as well
+        changed_.notify_all();
+        return Reservation(*this, bytes);
+    }
+
+    // Budget in bytes, 0 if unlimited
+    size_t budget() const {
+        return budget_;
+    }
+
+    size_t peakReserved() const {
+        lock_guard<mutex> lock(mutex_);
+        return peakReserved_;
+    }
+
+    // Number of jobs that had to wait for memory
+    size_t waitedJobs() const {
+        lock_guard<mutex> lock(mutex_);
+        return waitedJobs_;
+    }
+
+private:
+    MemoryBudget() : budget_(megabytesFromEnvironment("VR_MEMORY_BUDGET_MB", 1024)) {}
+
+    void release(size_t bytes) {
+        lock_guard<mutex> lock(mutex_);
+        reserved_ -= bytes;
+        changed_.notify_all();
+    }
+
+    size_t budget_;
+    size_t reserved_ = 0;
+    size_t peakReserved_ = 0;
+    size_t waitedJobs_ = 0;
+    uint64_t nextSequence_ = 0;
+    // Waiting jobs by (priority class, arrival)
+    set<pair<size_t, uint64_t>> waiting_;
+    mutable std::mutex mutex_;
+    condition_variable changed_;
+};
+
+/**
+ * Function to estimate the peak memory of a job
+ * 
+ * The audio itself is streamed from disk, so the estimate covers the decoded samples
+ * for the fingerprint (with room for vector growth), the in-memory part of the
+ * transcription and chat responses, and a fixed allowance for the transcript and the
+ * job's JSON documents. The local transcription backend also decodes the audio at
+ * 16 kHz and converts it to 16-bit samples for the WAV file (about 345 MB per hour
+ * before vector growth).
+ * 
+ * @param audioPath Path to the audio file
+ * @param transcriptionBackend Name of the job's transcription backend
+ * @return Estimated bytes
+ */
+size_t estimateJobMemory(const string &audioPath, const string &transcriptionBackend) {
+    static const size_t kJobBaseBytes = 4 << 20;
+    error_code ec;
+    uintmax_t audioBytes = std::filesystem::file_size(audioPath, ec);
+    double seconds = ec ? 0 : audioBytes / kCompressedAudioBytesPerSecond;
+    size_t bytes = kJobBaseBytes + 2 * SpillBuffer::memoryAllowance();
+    if (FingerprintIndex::instance().enabled()) {
+        bytes += static_cast<size_t>(2 * seconds * kFingerprintSampleRate * sizeof(float));
+    }
+    if (transcriptionBackend == "local") {
+        bytes += static_cast<size_t>(seconds * WhisperCppTranscriptionBackend::kSampleRate
+                                     * (2 * sizeof(float) + sizeof(int16_t)));
+    }
+    return bytes;
+}
+
+/**
+ * A recording to run through the pipeline
+ */
+struct RecordingJob {
+    string audioPath;
+    // Notion database that receives the page (e.g. the database of the recording's team)
+    string notionDatabaseId;
+    // LaTeX report to write; empty to name it after the stored JSON in reports/
+    string latexPath;
+    JobPriority priority = JobPriority::Normal;
+    // Transcription backend: "api" or "local" (see makeTranscriptionBackend)
+    string transcriptionBackend = defaultTranscriptionBackend();
+    // Stored categorized JSON of a job whose Notion delivery was parked; only that delivery is retried
+    string storedJsonPath;
+    // Notion page created before the job was parked, filled in rather than created again
+    string notionPageId;
+    // Taken from the parked job queue; parked again on any failure, so that none is lost
+    bool resumed = false;
+};
+
+/**
+ * Durable queue of jobs put aside while an API host is unavailable
+ * 
+ * A job refused by an open circuit breaker is appended to the queue file
+ * (VR_PARKED_JOBS, default cache/parked_jobs.tsv) as a batch manifest line, and
+ * synced to disk, so the jobs survive the process. Running --batch on the queue
+ * file resumes them; the file is renamed to "<path>.resuming" while it is worked
+ * off, so that jobs parked again start a new queue. Every resumed job that fails is
+ * parked again, and the "<path>.resuming" file is removed only once the whole run
+ * has succeeded. If the run is cut short, the next process puts the jobs of the
+ * leftover file back into the queue when it starts.
+ * 
+ * The line keeps the Notion page created for the job, if any, so that the retry
+ * fills it in instead of leaving it behind. A job refused only by Notion also keeps
+ * its stored categorized JSON, and the retry delivers just that to Notion.
+ */
+class ParkedJobQueue {
+public:
+    static ParkedJobQueue &instance() {
+        static ParkedJobQueue queue;
+        return queue;
+    }
+
+    const string &path() const {
+        return path_;
+    }
+
+    size_t parkedCount() const {
+        return parked_.load(memory_order_relaxed);
     }
-    payload["properties"] = properties;
-    
-    // Convert the payload JSON to a string
-    string payloadStr = payload.dump();
-    
-    // Set up CURL for the HTTP POST request to Notion's API.
-    CURL *curl;
-    CURLcode res;
-    string responseString;
-    
-    curl_global_init(CURL_GLOBAL_DEFAULT);
-    curl = curl_easy_init();
-    if (curl) {
-        // Set up the required headers.
-        struct curl_slist *headers = nullptr;
-        headers = curl_slist_append(headers, ("Authorization: Bearer " + notionApiKey).c_str());
-        headers = curl_slist_append(headers, "Content-Type: application/json");
-        headers = curl_slist_append(headers, "Notion-Version: 2022-06-28"); // Adjust if needed
 
-        // Set the Notion API endpoint for creating a page
-        curl_easy_setopt(curl, CURLOPT_URL, "https://api.notion.com/v1/pages");
-        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-        curl_easy_setopt(curl, CURLOPT_POST, 1L);
-        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, payloadStr.c_str());
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &responseString);
-        
-        // Perform the request
-        res = curl_easy_perform(curl);
-        if (res != CURLE_OK) {
-            cerr << "CURL error (Notion API): " << curl_easy_strerror(res) << endl;
-            curl_slist_free_all(headers);
-            curl_easy_cleanup(curl);
-            curl_global_cleanup();
+    /**
+     * Function to append a job to the queue
+     *
+     * @param job The job
+     * @return false if the queue file could not be written
+     */
+    bool park(const RecordingJob &job) {
+        string line = job.audioPath + "\t" + job.notionDatabaseId + "\t"
+                      + kJobPriorityNames[static_cast<size_t>(job.priority)] + "\t" + job.transcriptionBackend + "\t"
+                      + job.storedJsonPath + "\t" + job.notionPageId + "\n";
+        lock_guard<mutex> lock(mutex_);
+        if (!append(line)) {
+            cerr << "Failed to park " << job.audioPath << " in " << path_ << endl;
             return false;
         }
-        
-        // Check the response for errors
-        try {
-            auto responseJson = json::parse(responseString);
-            if (responseJson.contains("object") && responseJson["object"] == "error") {
-                cerr << "Notion API error: " << responseJson["message"].get<string>() << endl;
-                cout << "Notion API response:" << endl << responseString << endl;
-                curl_slist_free_all(headers);
-                curl_easy_cleanup(curl);
-                curl_global_cleanup();
-                return false;
+        parked_.fetch_add(1, memory_order_relaxed);
+        cout << "Parked " << (job.storedJsonPath.empty() ? "" : "the Notion delivery of ") << job.audioPath << " in "
+             << path_ << " until the service recovers" << endl;
+        return true;
+    }
+
+    /**
+     * Function to append the Notion delivery of a stored result to the queue
+     *
+     * @param job The job that produced the result
+     * @param storedJsonPath Path of its stored categorized JSON (empty to park the whole job)
+     * @param notionPageId ID of the page to fill in on the retry, empty if none was created
+     * @return false if the queue file could not be written
+     */
+    bool parkNotionDelivery(RecordingJob job, const string &storedJsonPath, const string &notionPageId) {
+        job.storedJsonPath = storedJsonPath;
+        job.notionPageId = notionPageId;
+        return park(job);
+    }
+
+private:
+    ParkedJobQueue() {
+        const char *configured = getenv("VR_PARKED_JOBS");
+        path_ = configured && *configured ? configured : "cache/parked_jobs.tsv";
+        recoverInterruptedResume();
+    }
+
+    // Append lines to the queue file and sync it to disk
+    bool append(const string &lines) {
+        error_code ec;
+        std::filesystem::path parent = std::filesystem::path(path_).parent_path();
+        if (!parent.empty()) {
+            std::filesystem::create_directories(parent, ec);
+        }
+        int fd = open(path_.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+        bool written = fd >= 0 && write(fd, lines.data(), lines.size()) == static_cast<ssize_t>(lines.size())
+                       && fsync(fd) == 0;
+        if (fd >= 0) {
+            close(fd);
+        }
+        return written;
+    }
+
+    // Put the jobs of a resume that did not finish back into the queue (once each)
+    void recoverInterruptedResume() {
+        string resumingPath = path_ + ".resuming";
+        ifstream leftover(resumingPath);
+        if (!leftover.is_open()) {
+            return;
+        }
+        set<string> queued;
+        string line;
+        {
+            ifstream queue(path_);
+            while (getline(queue, line)) {
+                queued.insert(line);
             }
-        } catch (const exception& e) {
-            // If we can't parse the response, just print it
-            cout << "Notion API response:" << endl << responseString << endl;
         }
-        
-        // Clean up
-        curl_slist_free_all(headers);
-        curl_easy_cleanup(curl);
+        string lines;
+        size_t recovered = 0;
+        while (getline(leftover, line)) {
+            if (!line.empty() && line[0] != '#' && queued.insert(line).second) {
+                lines += line + "\n";
+                ++recovered;
+            }
+        }
+        leftover.close();
+        if (!lines.empty() && !append(lines)) {
+            cerr << "Failed to recover the jobs of " << resumingPath << " into " << path_ << endl;
+            return;
+        }
+        error_code ec;
+        std::filesystem::remove(resumingPath, ec);
+        if (recovered > 0) {
+            cout << "Recovered " << recovered << " parked jobs of an interrupted resume into " << path_ << endl;
+        }
     }
-    curl_global_cleanup();
-    
-    return true;
-}
+
+    string path_;
+    atomic<size_t> parked_{0};
+    std::mutex mutex_;
+};
 
 /**
- * Main function - Entry point of the application
+ * Function to run one recording through the whole pipeline
  * 
  * This function:
- * 1. Prompts the user to select an audio file
- * 2. Transcribes the audio using OpenAI's Whisper API
- * 3. Analyzes the transcription using GPT-4o
- * 4. Sends the categorized data to a Notion database
+ * 1. Transcribes the audio, unless a near-duplicate recording was processed before
+ * 2. Creates the Notion page with its basic metadata while the transcript is categorized
+ * 3. Categorizes the transcript (or reuses a cached categorization)
+ * 4. Stores the categorized JSON and hands the result to the SinkDispatcher, which
+ *    fills in the Notion page, renders the LaTeX report, etc. in the background
  * 
- * @return 0 on successful execution
- */// Function to convert JSON data to LaTeX format
-string convertToLatex(const nlohmann::json &data) {
-    ostringstream latex;
-    
-    // Start the LaTeX document
-    latex << "\\documentclass{article}\n";
-    latex << "\\usepackage{geometry}\n";
-    latex << "\\usepackage{enumitem}\n";
-    latex << "\\usepackage{hyperref}\n";
-    latex << "\\usepackage{xcolor}\n";
-    latex << "\\usepackage{titlesec}\n";
-    latex << "\\usepackage{fancyhdr}\n";
-    latex << "\\usepackage{booktabs}\n";
-    
-    // Set up the document
-    latex << "\\geometry{margin=1in}\n";
-    latex << "\\titleformat{\\section}{\\normalfont\\Large\\bfseries}{\\thesection}{1em}{}\n";
-    latex << "\\pagestyle{fancy}\n";
-    latex << "\\fancyhf{}\n";
-    latex << "\\renewcommand{\\headrulewidth}{0pt}\n";
-    latex << "\\fancyfoot[C]{\\thepage}\n";
-    
-    // Begin the document
-    latex << "\\begin{document}\n\n";
-    
-    // Add the title
-    if (data.contains("Summary")) {
-        string summary = data["Summary"].is_string() ? data["Summary"].get<string>() : data["Summary"].dump();
-        latex << "\\title{" << summary << "}\n";
-        latex << "\\author{Generated by AI Analysis}\n";
-        latex << "\\date{\\today}\n";
-        latex << "\\maketitle\n\n";
-    }
-    
-    // Add metadata section
-    latex << "\\section*{Metadata}\n";
-    latex << "\\begin{tabular}{ll}\n";
-    latex << "\\toprule\n";
-    
-    // Add Type
-    if (data.contains("Type")) {
-        string type = data["Type"].is_string() ? data["Type"].get<string>() : data["Type"].dump();
-        latex << "Type & " << type << " \\\\\n";
-    }
-    
-    // Add Duration
-    if (data.contains("Duration")) {
-        string duration = data["Duration"].is_string() ? data["Duration"].get<string>() : data["Duration"].dump();
-        latex << "Duration & " << duration << " \\\\\n";
+ * Jobs share no mutable state besides the internally synchronized caches and indexes,
+ * so several can run at once, each writing to its own Notion database.
+ * 
+ * @param job The recording and where its results go
+ * @param apiKey OpenAI API key for authentication
+ * @param notionApiKey Notion API key for authentication
+ * @param earlyNotionPageId Set to the ID of the Notion page created early when the job is
+ *        refused, so that the parked job fills it in (may be null)
+ * @return true if the recording was transcribed and its result stored; false with
+ *         CircuitBreakers::refusedOnThisThread() set if OpenAI was unavailable
+ */
+bool processRecording(const RecordingJob &job, const string &apiKey, const string &notionApiKey,
+                      string *earlyNotionPageId = nullptr) {
+    // Admission control: wait until the job's estimated peak memory fits in the budget
+    MemoryBudget::Reservation memory = MemoryBudget::instance().reserve(
+        estimateJobMemory(job.audioPath, job.transcriptionBackend), job.priority);
+    // Every request of the job, including those sent by the sinks, is bounded by its deadline
+    DeadlineScope deadline(RequestTimeouts::instance().jobDeadline());
+    CircuitBreakers::refusedOnThisThread() = false;
+
+    // Look for an earlier recording of the same audio, even if it was encoded differently
+    FingerprintIndex &fingerprintIndex = FingerprintIndex::instance();
+    vector<uint32_t> fingerprint;
+    FingerprintIndex::Match duplicate{nullptr, 1.0};
+    double audioSeconds = 0;
+    if (fingerprintIndex.enabled()) {
+        vector<float> samples;
+        if (decodeAudioToPcm(job.audioPath, kFingerprintSampleRate, samples)) {
+            fingerprint = computeAudioFingerprint(samples);
+            audioSeconds = static_cast<double>(samples.size()) / kFingerprintSampleRate;
+            duplicate = fingerprintIndex.findNearDuplicate(fingerprint);
+        } else {
+            cerr << "Could not decode audio for duplicate detection (is ffmpeg installed?)" << endl;
+        }
     }
     
-    // Add AI Cost
-    if (data.contains("AI Cost")) {
-        string cost = data["AI Cost"].is_string() ? data["AI Cost"].get<string>() : data["AI Cost"].dump();
-        latex << "AI Cost & " << cost << " \\\\\n";
-    } else if (data.contains("At Cost")) {
-        string cost = data["At Cost"].is_string() ? data["At Cost"].get<string>() : data["At Cost"].dump();
-        latex << "AI Cost & " << cost << " \\\\\n";
+    string transcriptionText;
+    TimedTranscript timings;
+    bool transcribed = false;
+    if (duplicate.entry) {
+        cout << "Recording matches " << duplicate.entry->audioPath << " (bit error rate "
+             << fixed << setprecision(3) << duplicate.bitErrorRate << "), reusing its transcript" << endl;
+        transcriptionText = duplicate.entry->transcript;
+        transcribed = true;
+    } else {
+        unique_ptr<TranscriptionBackend> backend = makeTranscriptionBackend(job.transcriptionBackend, apiKey);
+        if (!backend) {
+            cerr << "Unknown transcription backend: " << job.transcriptionBackend << endl;
+            return false;
+        }
+        // Wait for the transcription stage; the cost is the audio length, estimated from the size if unknown
+        error_code ec;
+        uintmax_t audioBytes = std::filesystem::file_size(job.audioPath, ec);
+        double cost = audioSeconds > 0 ? audioSeconds : ec ? 0 : audioBytes / kCompressedAudioBytesPerSecond;
+        StageScheduler &stage = backend->runsLocally() ? StageScheduler::localTranscription()
+                                                        : StageScheduler::transcription();
+        StageScheduler::Slot slot = stage.acquire(job.priority, cost);
+
+        // Transcribe audio
+        cout << "Transcribing audio file: " << job.audioPath << " (" << backend->name() << ")..." << endl;
+        transcriptionText = transcribeToText(*backend, job.audioPath, transcribed, &timings);
+        if (!transcribed && CircuitBreakers::refusedOnThisThread()) {
+            return false;
+        }
+        if (timings.durationMs > 0) {
+            audioSeconds = timings.durationMs / 1000.0;
+        }
     }
     
-    // Add Date
-    if (data.contains("Date")) {
-        string date = data["Date"].is_string() ? data["Date"].get<string>() : data["Date"].dump();
-        latex << "Date & " << date << " \\\\\n";
+    // Create the Notion page with its basic metadata while the transcript is categorized
+    bool reusedPage = duplicate.entry && !duplicate.entry->notionPageId.empty();
+    // The job's database is resolved once, and its context shared by every Notion request of the job
+    NotionDatabaseRegistry::ContextFuture notionDatabase;
+    if (SinkDispatcher::instance().hasSink("notion")) {
+        notionDatabase = NotionDatabaseRegistry::instance().context(job.notionDatabaseId, notionApiKey);
     }
-    
-    // Add Icon
-    if (data.contains("Icon")) {
-        string icon = data["Icon"].is_string() ? data["Icon"].get<string>() : data["Icon"].dump();
-        latex << "Icon & " << icon << " \\\\\n";
+    shared_future<string> earlyPage;
+    if (!job.notionPageId.empty()) {
+        // The page was created before the job was parked
+        promise<string> createdPage;
+        createdPage.set_value(job.notionPageId);
+        earlyPage = createdPage.get_future().share();
+    } else if (!reusedPage && SinkDispatcher::instance().hasSink("notion")) {
+        // The request may outlive the job's arena, so its document is allocated on the heap
+        JobArenaScope heapScope(nullptr);
+        earlyPage = async(launch::async, [notionDatabase, notionApiKey,
+                                          deadline = RequestTimeouts::currentDeadline(),
+                                          metadata = earlyNotionMetadata(job.audioPath, audioSeconds)] {
+            DeadlineScope deadlineScope(deadline);
+            shared_ptr<const NotionDatabaseContext> database = notionDatabase.get();
+            string notionPageId;
+            return database && sendToNotion(metadata, *database, notionApiKey, &notionPageId) ? notionPageId : string();
+        }).share();
     }
     
-    latex << "\\bottomrule\n";
-    latex << "\\end{tabular}\n\n";
-    
-    // Add Main Points section
-    if (data.contains("Main Points")) {
-        latex << "\\section{Main Points}\n";
-        latex << "\\begin{itemize}[leftmargin=*]\n";
-        
-        if (data["Main Points"].is_array()) {
-            for (const auto& point : data["Main Points"]) {
-                string pointText = point.is_string() ? point.get<string>() : point.dump();
-                latex << "  \\item " << pointText << "\n";
+    // Short transcripts go to a faster model, within the configured latency and cost budgets
+    string categorizationModel = ModelRouter::instance().choose(transcriptionText);
+
+    // Reuse the categorization of an identical transcript if one is cached
+    json categorizedJson;
+    CategorizationCache &categorizationCache = CategorizationCache::instance();
+    uint64_t cacheKey = categorizationCacheKey(transcriptionText, categorizationModel);
+    if (categorizationCache.lookup(cacheKey, categorizedJson)) {
+        cout << "Using cached categorization for this transcript" << endl;
+    } else {
+        // Process transcription with the routed model's chat completions backend
+        unique_ptr<CategorizationBackend> backend = makeCategorizationBackend(categorizationModel, apiKey);
+        cout << "Processing transcription with the " << backend->name() << " chat model (" << categorizationModel
+             << ")..." << endl;
+        bool parsed = false;
+        {
+            StageScheduler &stage = backend->runsLocally() ? StageScheduler::localCategorization()
+                                                            : StageScheduler::categorization();
+            StageScheduler::Slot slot = stage.acquire(job.priority, estimateTokenCount(transcriptionText));
+            categorizedJson = categorizeTranscription(transcriptionText, *backend, parsed, categorizationModel);
+        }
+        if (parsed) {
+            categorizationCache.store(cacheKey, categorizedJson);
+        } else if (CircuitBreakers::refusedOnThisThread()) {
+            // The model's server is down: park the job instead of storing it without its categorization,
+            // along with its early page
+            if (earlyNotionPageId && earlyPage.valid()) {
+                *earlyNotionPageId = earlyPage.get();
             }
+            return false;
         } else {
-            string mainPoints = data["Main Points"].is_string() ? data["Main Points"].get<string>() : data["Main Points"].dump();
-            latex << "  \\item " << mainPoints << "\n";
+            // Keep only what is actually known instead of inventing content
+            cerr << "Categorization failed; keeping only the basic metadata" << endl;
+            categorizedJson = earlyNotionMetadata(job.audioPath, audioSeconds);
+        }
+    }
+    // Fields the reply left empty keep the early page's metadata (such as the duration)
+    json metadata = earlyNotionMetadata(job.audioPath, audioSeconds);
+    for (const auto &[key, value] : metadata.items()) {
+        auto field = categorizedJson.find(key);
+        if (field != categorizedJson.end() && CategorizationSchema::isEmpty(*field)) {
+            *field = value;
         }
-        
-        latex << "\\end{itemize}\n\n";
     }
     
-    // Add Action Items section
-    if (data.contains("Action Items")) {
-        latex << "\\section{Action Items}\n";
-        latex << "\\begin{itemize}[leftmargin=*]\n";
-        
-        if (data["Action Items"].is_array()) {
-            for (const auto& item : data["Action Items"]) {
-                string itemText = item.is_string() ? item.get<string>() : item.dump();
-                latex << "  \\item " << itemText << "\n";
+    // Keep the categorized JSON and its transcript so reports can be regenerated offline
+    json storedJson = categorizedJson;
+    storedJson["Transcript"] = transcriptionText;
+    string jsonFilePath = saveCategorizedJson(storedJson, "categorized");
+    if (!jsonFilePath.empty()) {
+        cout << "Categorized JSON saved to " << jsonFilePath << endl;
+        if (!timings.empty()) {
+            string timingsFilePath = std::filesystem::path(jsonFilePath).replace_extension(".timings.tsv").string();
+            if (saveTimedTranscript(timings, timingsFilePath)) {
+                cout << "Word and segment timings saved to " << timingsFilePath << endl;
             }
-        } else {
-            string actionItems = data["Action Items"].is_string() ? data["Action Items"].get<string>() : data["Action Items"].dump();
-            latex << "  \\item " << actionItems << "\n";
         }
-        
-        latex << "\\end{itemize}\n\n";
     }
-    
-    // Add Follow-up Questions section
-    if (data.contains("Follow-up Questions")) {
-        latex << "\\section{Follow-up Questions}\n";
-        latex << "\\begin{itemize}[leftmargin=*]\n";
-        
-        if (data["Follow-up Questions"].is_array()) {
-            for (const auto& question : data["Follow-up Questions"]) {
-                string questionText = question.is_string() ? question.get<string>() : question.dump();
-                latex << "  \\item " << questionText << "\n";
+    // Make the transcript and its results searchable with --search
+    indexForSearch(categorizedJson, transcriptionText, jsonFilePath);
+
+    // Hand the result to the sinks, which deliver it after this job has moved on
+    auto result = make_shared<CategorizedResult>();
+    {
+        JobArenaScope heapScope(nullptr);
+        result->data = categorizedJson;
+        result->storedData = storedJson;
+    }
+    result->audioPath = job.audioPath;
+    result->jsonPath = jsonFilePath;
+    result->latexPath = job.latexPath;
+    if (result->latexPath.empty()) {
+        string name = jsonFilePath.empty() ? std::filesystem::path(job.audioPath).stem().string()
+                                           : std::filesystem::path(jsonFilePath).stem().string();
+        error_code ec;
+        std::filesystem::create_directories("reports", ec);
+        result->latexPath = (std::filesystem::path("reports") / (name + ".tex")).string();
+    }
+    result->notionDatabaseId = job.notionDatabaseId;
+    result->notionDatabase = notionDatabase;
+    result->deadline = RequestTimeouts::currentDeadline();
+    result->earlyNotionPage = earlyPage;
+    // The result is stored and indexed already, so only the Notion delivery is retried
+    result->parkForRetry = [job, jsonFilePath](const string &notionPageId) {
+        ParkedJobQueue::instance().parkNotionDelivery(job, jsonFilePath, notionPageId);
+    };
+    result->parkOnFailure = job.resumed;
+    if (reusedPage) {
+        result->existingNotionPageId = duplicate.entry->notionPageId;
+    }
+
+    // Remember this recording so later near-duplicates can reuse its transcript and page
+    if (transcribed && !fingerprint.empty() && !reusedPage) {
+        auto remember = [&fingerprintIndex, audioPath = job.audioPath, transcriptionText,
+                         fingerprint = move(fingerprint),
+                         isDuplicate = duplicate.entry != nullptr](const string &notionPageId) {
+            if (!isDuplicate || !notionPageId.empty()) {
+                fingerprintIndex.add({audioPath, notionPageId, transcriptionText, fingerprint});
             }
+        };
+        if (SinkDispatcher::instance().hasSink("notion")) {
+            result->notionPageReady = remember;
         } else {
-            string questions = data["Follow-up Questions"].is_string() ? data["Follow-up Questions"].get<string>() : data["Follow-up Questions"].dump();
-            latex << "  \\item " << questions << "\n";
+            remember("");
         }
-        
-        latex << "\\end{itemize}\n\n";
     }
-    
-    // Add Arguments section
-    if (data.contains("Arguments")) {
-        latex << "\\section{Arguments}\n";
-        
-        if (data["Arguments"].is_object()) {
-            for (auto& [key, value] : data["Arguments"].items()) {
-                string argTitle = key;
-                string argContent = value.is_string() ? value.get<string>() : value.dump();
-                
-                latex << "\\subsection*{" << argTitle << "}\n";
-                latex << argContent << "\n\n";
-            }
-        } else if (data["Arguments"].is_array()) {
-            latex << "\\begin{itemize}[leftmargin=*]\n";
-            for (const auto& arg : data["Arguments"]) {
-                string argText = arg.is_string() ? arg.get<string>() : arg.dump();
-                latex << "  \\item " << argText << "\n";
-            }
-            latex << "\\end{itemize}\n\n";
-        } else {
-            string arguments = data["Arguments"].is_string() ? data["Arguments"].get<string>() : data["Arguments"].dump();
-            latex << arguments << "\n\n";
+    SinkDispatcher::instance().dispatch(move(result));
+    return transcribed && !jsonFilePath.empty();
+}
+
+/**
+ * Function to retry the Notion delivery of a parked job
+ * 
+ * The job's result was stored, indexed and delivered to the other sinks before it
+ * was parked, so it is read back from its stored JSON and queued for the Notion
+ * sink alone.
+ * 
+ * @param job The parked job, with its storedJsonPath
+ * @return true if the result was queued for Notion
+ */
+bool resumeNotionDelivery(const RecordingJob &job) {
+    SinkDispatcher &sinks = SinkDispatcher::instance();
+    if (!sinks.hasSink("notion")) {
+        cerr << "Cannot resume the Notion delivery of " << job.audioPath << " without the notion sink" << endl;
+        return false;
+    }
+    DeadlineScope deadline(RequestTimeouts::instance().jobDeadline());
+    auto result = make_shared<CategorizedResult>();
+    {
+        // The result outlives this call, so its documents are allocated on the heap
+        JobArenaScope heapScope(nullptr);
+        ifstream file(job.storedJsonPath);
+        result->storedData = json::parse(file, nullptr, false);
+        if (!result->storedData.is_object()) {
+            cerr << "Failed to read the stored result " << job.storedJsonPath << endl;
+            return false;
         }
+        result->data = result->storedData;
+        result->data.erase("Transcript");
     }
-    
-    // Add References section
-    if (data.contains("References")) {
-        latex << "\\section{References}\n";
-        latex << "\\begin{itemize}[leftmargin=*]\n";
-        
-        if (data["References"].is_array()) {
-            for (const auto& ref : data["References"]) {
-                string refText = ref.is_string() ? ref.get<string>() : ref.dump();
-                latex << "  \\item " << refText << "\n";
-            }
-        } else {
-            string references = data["References"].is_string() ? data["References"].get<string>() : data["References"].dump();
-            latex << "  \\item " << references << "\n";
+    result->audioPath = job.audioPath;
+    result->jsonPath = job.storedJsonPath;
+    result->notionDatabaseId = job.notionDatabaseId;
+    result->notionDatabase = NotionDatabaseRegistry::instance().context(job.notionDatabaseId, NOTION_API_KEY);
+    result->deadline = RequestTimeouts::currentDeadline();
+    if (!job.notionPageId.empty()) {
+        promise<string> createdPage;
+        createdPage.set_value(job.notionPageId);
+        result->earlyNotionPage = createdPage.get_future().share();
+    }
+    result->parkForRetry = [job](const string &notionPageId) {
+        ParkedJobQueue::instance().parkNotionDelivery(job, job.storedJsonPath, notionPageId);
+    };
+    result->parkOnFailure = true;
+    cout << "Resuming the Notion delivery of " << job.audioPath << endl;
+    sinks.dispatch(move(result), "notion");
+    return true;
+}
+
+/**
+ * Function to process many recordings concurrently
+ * 
+ * Each line of the manifest names an audio file, optionally followed by tab-separated
+ * the ID of the Notion database it belongs to (empty or missing for NOTION_DATABASE_ID),
+ * its priority class ("interactive", "normal" or "bulk"; default "normal") and its
+ * transcription backend ("api" or "local"; default VR_TRANSCRIPTION_BACKEND).
+ * Two more columns, written by the ParkedJobQueue, hold the stored JSON of a parked
+ * Notion delivery and the ID of the Notion page to fill in. Blank lines and lines starting with '#' are skipped. Reports are written to reports/.
+ * 
+ * Recordings wait for the transcription and categorization stages in weighted fair
+ * order (see StageScheduler), so interactive notes overtake a bulk backlog. At the end,
+ * the completion times and stage waits of each priority class are printed.
+ * 
+ * Recordings refused by an open circuit breaker are parked in the ParkedJobQueue,
+ * whose file is itself a manifest for a later run; results refused only by Notion
+ * are parked by the Notion sink, and the later run just delivers them.
+ * 
+ * @param manifestPath Path of the manifest
+ * @param threadCount Number of recordings in flight at once (0 for every recording,
+ *        up to kMaxBatchThreads, so that each one queues at the stages)
+ * @return true if every recording was processed
+ */
+bool processBatch(const string &manifestPath, size_t threadCount) {
+    static const size_t kMaxBatchThreads = 256;
+    // Recovers the jobs of an interrupted resume into the queue before it may be read
+    ParkedJobQueue &parked = ParkedJobQueue::instance();
+    error_code ec;
+    bool resuming = std::filesystem::equivalent(manifestPath, parked.path(), ec);
+    ifstream manifest(manifestPath);
+    if (!manifest.is_open()) {
+        cerr << "Failed to open manifest: " << manifestPath << endl;
+        return false;
+    }
+    vector<RecordingJob> jobs;
+    string line;
+    while (getline(manifest, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
         }
-        
-        latex << "\\end{itemize}\n\n";
+        vector<string> columns;
+        stringstream fields(line);
+        string field;
+        while (getline(fields, field, '\t')) {
+            columns.push_back(field);
+        }
+        RecordingJob job;
+        job.audioPath = columns[0];
+        job.notionDatabaseId = columns.size() > 1 && !columns[1].empty() ? columns[1] : NOTION_DATABASE_ID;
+        if (columns.size() > 2 && !columns[2].empty() && !parseJobPriority(columns[2], job.priority)) {
+            cerr << "Unknown priority \"" << columns[2] << "\" for " << job.audioPath << ", using normal" << endl;
+        }
+        if (columns.size() > 3 && !columns[3].empty()) {
+            job.transcriptionBackend = columns[3];
+        }
+        if (columns.size() > 4) {
+            job.storedJsonPath = columns[4];
+        }
+        if (columns.size() > 5) {
+            job.notionPageId = columns[5];
+        }
+        job.resumed = resuming;
+        jobs.push_back(move(job));
     }
-    
-    // Add Stories section
-    if (data.contains("Stories")) {
-        latex << "\\section{Stories}\n";
-        latex << "\\begin{itemize}[leftmargin=*]\n";
-        
-        if (data["Stories"].is_array()) {
-            for (const auto& story : data["Stories"]) {
-                string storyText = story.is_string() ? story.get<string>() : story.dump();
-                latex << "  \\item " << storyText << "\n";
+    manifest.close();
+
+    // Resuming parked jobs: take over the queue, so that jobs parked again start a new one
+    string resumedQueue;
+    if (resuming) {
+        resumedQueue = manifestPath + ".resuming";
+        std::filesystem::rename(manifestPath, resumedQueue, ec);
+    }
+
+    if (threadCount == 0) {
+        threadCount = max<size_t>(1, min(jobs.size(), kMaxBatchThreads));
+    }
+    cout << "Processing " << jobs.size() << " recordings on " << threadCount << " threads..." << endl;
+
+    auto startTime = chrono::steady_clock::now();
+    atomic<size_t> failures{0};
+    atomic<size_t> parkedJobs{0};
+    vector<double> completionSeconds(jobs.size());
+    {
+        WorkStealingPool pool(threadCount);
+        for (size_t index = 0; index < jobs.size(); ++index) {
+            pool.submit([&failures, &parkedJobs, &parked, &jobs, &completionSeconds, startTime, index] {
+                thread_local JobArena arena;
+                const RecordingJob &job = jobs[index];
+                // While the job's service is down, jobs are put aside without spending a worker on them
+                bool deliveryOnly = !job.storedJsonPath.empty();
+                bool refused = CircuitBreakers::instance().isOpen(deliveryOnly ? notionBaseUrl() : openAiBaseUrl());
+                bool processed = false;
+                RecordingJob parkedJob = job;
+                if (!refused && deliveryOnly) {
+                    processed = resumeNotionDelivery(job);
+                } else if (!refused) {
+                    // Every document of the job lives in the worker's arena, rewound after the job
+                    JobArenaScope arenaScope(arena);
+                    processed = processRecording(job, OPENAI_API_KEY, NOTION_API_KEY, &parkedJob.notionPageId);
+                    refused = !processed && CircuitBreakers::refusedOnThisThread();
+                }
+                // A resumed job is parked again whatever the failure, so that it stays queued
+                if (!processed && (refused || job.resumed) && parked.park(parkedJob)) {
+                    parkedJobs.fetch_add(1, memory_order_relaxed);
+                } else if (!processed) {
+                    failures.fetch_add(1, memory_order_relaxed);
+                    cerr << "Failed to process " << job.audioPath << endl;
+                }
+                arena.reset();
+                completionSeconds[index] = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+            });
+        }
+        pool.wait();
+    }
+    SinkDispatcher &sinks = SinkDispatcher::instance();
+    bool delivered = sinks.drain();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+    cout << "Processed " << jobs.size() - failures.load() - parkedJobs.load() << " of " << jobs.size()
+         << " recordings in " << fixed << setprecision(2) << seconds << "s" << endl;
+
+    for (size_t priorityClass = 0; priorityClass < 3; ++priorityClass) {
+        JobPriority priority = static_cast<JobPriority>(priorityClass);
+        vector<double> completed;
+        for (size_t index = 0; index < jobs.size(); ++index) {
+            if (jobs[index].priority == priority) {
+                completed.push_back(completionSeconds[index]);
             }
-        } else {
-            string stories = data["Stories"].is_string() ? data["Stories"].get<string>() : data["Stories"].dump();
-            latex << "  \\item " << stories << "\n";
         }
-        
-        latex << "\\end{itemize}\n\n";
+        if (completed.empty()) {
+            continue;
+        }
+        sort(completed.begin(), completed.end());
+        cout << "  " << left << setw(12) << kJobPriorityNames[priorityClass] << right << completed.size()
+             << " recordings, done after p50 " << setprecision(2) << completed[completed.size() / 2]
+             << "s, max " << completed.back() << "s";
+        for (StageScheduler *stage : {&StageScheduler::transcription(), &StageScheduler::localTranscription(),
+                                      &StageScheduler::categorization(), &StageScheduler::localCategorization()}) {
+            StageScheduler::ClassStats stats = stage->stats(priority);
+            if (stats.admitted > 0) {
+                cout << "; " << stage->name() << " wait mean " << setprecision(0)
+                     << stats.totalWaitMs / stats.admitted << " ms, max " << stats.maxWaitMs << " ms";
+            }
+        }
+        cout << endl;
     }
-    
-    // Add Sentiment section
-    if (data.contains("Sentiment")) {
-        latex << "\\section{Sentiment}\n";
-        string sentiment = data["Sentiment"].is_string() ? data["Sentiment"].get<string>() : data["Sentiment"].dump();
-        latex << sentiment << "\n\n";
+    for (const auto &sink : sinks.stats()) {
+        cout << "  " << left << setw(10) << sink.name << right << sink.delivered << " delivered, "
+             << sink.failed << " failed, at most " << sink.maxQueued << " queued" << endl;
     }
-    
-    // End the document
-    latex << "\\end{document}\n";
-    
-    return latex.str();
+
+    MemoryBudget &memory = MemoryBudget::instance();
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    cout << "  memory    peak " << (memory.peakReserved() >> 20) << " MB reserved";
+    if (memory.budget() > 0) {
+        cout << " of " << (memory.budget() >> 20) << " MB";
+    }
+    cout << ", " << memory.waitedJobs() << " recordings waited, " << SpillBuffer::spillCount()
+         << " responses spilled to disk, peak RSS " << usage.ru_maxrss / 1024 << " MB" << endl;
+    for (const auto &host : CircuitBreakers::instance().stats()) {
+        cout << "  circuit   " << host.host << " opened " << host.opened << " times, " << host.refused
+             << " requests refused" << endl;
+    }
+    if (parked.parkedCount() > 0) {
+        cout << "  parked    " << parked.parkedCount() << " recordings in " << parked.path() << "; resume them with --batch "
+             << parked.path() << endl;
+    }
+    // Every job of the resumed queue is done or parked again; otherwise the next run recovers it
+    if (!resumedQueue.empty() && failures.load() == 0 && delivered) {
+        std::filesystem::remove(resumedQueue, ec);
+    }
+    RequestHedger &hedger = RequestHedger::instance();
+    if (hedger.enabled()) {
+        RequestHedger::Stats hedging = hedger.stats();
+        cout << "  hedging   " << hedging.hedged << " of " << hedging.requests << " chat requests hedged (cap "
+             << setprecision(1) << hedger.maxRate() * 100 << "%), " << hedging.hedgeWins << " hedges answered first"
+             << endl;
+    }
+    return failures.load() == 0 && delivered && parked.parkedCount() == 0;
 }
 
-// Function to save LaTeX to a file
-bool saveLatexToFile(const string &latex, const string &filePath) {
-    ofstream file(filePath);
-    if (!file.is_open()) {
-        cerr << "Failed to open file for writing: " << filePath << endl;
+/**
+ * Function to open a connection to an API host, leaving it in the shared connection cache
+ * 
+ * @param baseUrl Base URL of the host
+ * @return true if the host answered
+ */
+bool openConnection(const string &baseUrl) {
+    CURL *curl = curl_easy_init();
+    if (!curl) {
         return false;
     }
-    
-    file << latex;
-    file.close();
-    
-    cout << "LaTeX saved to: " << filePath << endl;
-    return true;
+    string url = baseUrl + "/";
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+    RequestTimeouts::instance().apply(curl);
+    SharedConnections::instance().attach(curl);
+    CURLcode res = curl_easy_perform(curl);
+    curl_easy_cleanup(curl);
+    return res == CURLE_OK;
 }
-int main() {
-    cout << "Select an audio file for transcription." << endl;
-    string filePath = getFileFromDialog();
-    
-    // Use the API key from the config file
-    string apiKey = OPENAI_API_KEY;
-    
-    // Transcribe audio
-    cout << "Transcribing audio file: " << filePath << "..." << endl;
-    string transcriptionResponse = transcribeAudio(filePath, apiKey);
-    
-    // Parse the transcription JSON to extract the transcription text
-    string transcriptionText;
-    try {
-        auto jsonResponse = json::parse(transcriptionResponse);
-        // Assuming the transcription text is in the "text" field
-        transcriptionText = jsonResponse["text"];
-        cout << "Transcription:" << endl << transcriptionText << endl;
-    } catch (const exception& e) {
-        cerr << "Error parsing transcription JSON response: " << e.what() << endl;
-        cout << "Raw transcription response:" << endl << transcriptionResponse << endl;
-        transcriptionText = transcriptionResponse; // Fallback to raw response if parsing fails
+
+/**
+ * Function to prepare the first job's requests in the background
+ * 
+ * Opens a connection to OpenAI and loads the context of the Notion database (which
+ * also opens a connection to Notion), so that a job started later, typically once the
+ * user has picked a file, does not wait for handshakes or the schema request.
+ * Disabled with VR_CONNECTION_WARMUP=off, and while replaying recorded traffic.
+ * 
+ * @param notionDatabaseId ID of the Notion database the job will use
+ * @param notionApiKey Notion API key for authentication
+ * @return The background tasks; nothing needs to wait for them
+ */
+vector<future<void>> warmUpConnections(const string &notionDatabaseId, const string &notionApiKey) {
+    vector<future<void>> tasks;
+    const char *configured = getenv("VR_CONNECTION_WARMUP");
+    if ((configured && string(configured) == "off") || HttpFixtures::instance().mode() == HttpFixtures::Mode::Replay) {
+        return tasks;
     }
-    
-    // Process transcription with the Chat Completions API
-    cout << "Processing transcription with OpenAI Chat Completions API..." << endl;
-    string categorizedResponse = categorizeWithOpenAI(transcriptionText, apiKey);
-    
-    // Parse the categorized JSON response to extract the assistant's reply
-    nlohmann::json categorizedJson;
-    string assistantReply;
-    
-    try {
-        auto jsonResponse = json::parse(categorizedResponse);
-        // Chat completions responses usually include a "choices" array
-        assistantReply = jsonResponse["choices"][0]["message"]["content"];
-        cout << "Categorized Response:" << endl << assistantReply << endl;
-        
-        // Extract JSON from code block if present
-        try {
-            // Check if the response is wrapped in a code block
-            regex jsonBlockPattern("```json\\s*([\\s\\S]*?)\\s*```");
-            smatch matches;
-            if (regex_search(assistantReply, matches, jsonBlockPattern) && matches.size() > 1) {
-                // Extract the JSON content from the code block
-                string jsonContent = matches[1].str();
-                categorizedJson = json::parse(jsonContent);
-            } else {
-                // Try parsing directly if not in a code block
-                categorizedJson = json::parse(assistantReply);
-            }
-            
-            cout << "Parsed JSON successfully" << endl;
-        } catch (const exception& e) {
-            cerr << "Error parsing categorized JSON: " << e.what() << endl;
-            // Fallback to example JSON if parsing fails
-            categorizedJson = {
-                {"Summary", "This is a brief summary."},
-                {"Main Points", "Point A, Point B, Point C"},
-                {"Action Items", "Follow up on item 1 and item 2"},
-                {"Follow-up Questions", "What is the timeline?"},
-                {"Stories", "A brief anecdote..."},
-                {"References", "Reference details here"},
-                {"Arguments", "The arguments are..."},
-                {"Sentiment", "Positive"}
-            };
-            cout << "Using fallback JSON example" << endl;
+    tasks.push_back(async(launch::async, [] {
+        openConnection(openAiBaseUrl());
+    }));
+    if (SinkDispatcher::instance().hasSink("notion")) {
+        tasks.push_back(async(launch::async, [notionDatabaseId, notionApiKey] {
+            NotionDatabaseRegistry::instance().context(notionDatabaseId, notionApiKey).wait();
+        }));
+    }
+    return tasks;
+}
+
+/**
+ * Function to compare the transcription backends on the same recordings
+ * 
+ * Every recording is transcribed once by each backend, one after the other, and the
+ * wall time is compared with the audio length: a real-time factor (RTF) below 1 means
+ * faster than real time.
+ * 
+ * @param audioPaths The recordings
+ * @param apiKey OpenAI API key for the API backend
+ * @return true if every backend transcribed every recording
+ */
+bool benchmarkTranscription(const vector<string> &audioPaths, const string &apiKey) {
+    // Audio lengths, measured once from the decoded samples
+    vector<double> audioSeconds;
+    for (const string &audioPath : audioPaths) {
+        vector<float> samples;
+        if (!decodeAudioToPcm(audioPath, WhisperCppTranscriptionBackend::kSampleRate, samples)) {
+            cerr << "Could not decode " << audioPath << " (is ffmpeg installed?)" << endl;
+            return false;
         }
-    } catch (const exception& e) {
-        cerr << "Error parsing chat completions JSON response: " << e.what() << endl;
-        cout << "Raw categorized response:" << endl << categorizedResponse << endl;
-        // Fallback to example JSON if parsing fails
-        categorizedJson = {
-            {"Summary", "This is a brief summary."},
-            {"Main Points", "Point A, Point B, Point C"},
-            {"Action Items", "Follow up on item 1 and item 2"},
-            {"Follow-up Questions", "What is the timeline?"},
-            {"Stories", "A brief anecdote..."},
-            {"References", "Reference details here"},
-            {"Arguments", "The arguments are..."},
-            {"Sentiment", "Positive"}
-        };
-        cout << "Using fallback JSON example" << endl;
+        audioSeconds.push_back(static_cast<double>(samples.size()) / WhisperCppTranscriptionBackend::kSampleRate);
     }
-    
-    // Use the API keys from the config file
-    string notionDatabaseId = NOTION_DATABASE_ID;
-    string notionApiKey = NOTION_API_KEY;
 
-    if (sendToNotion(categorizedJson, notionDatabaseId, notionApiKey)) {
-        cout << "Data successfully sent to Notion." << endl;
-    } else {
-        cerr << "Failed to send data to Notion." << endl;
+    bool allSucceeded = true;
+    cout << left << setw(10) << "Backend" << right << setw(8) << "Files" << setw(8) << "Failed" << setw(12)
+         << "Audio (s)" << setw(12) << "Wall (s)" << setw(8) << "RTF" << setw(16) << "Audio s per s" << endl;
+    for (const char *name : {"api", "local"}) {
+        unique_ptr<TranscriptionBackend> backend = makeTranscriptionBackend(name, apiKey);
+        size_t failed = 0;
+        double totalAudio = 0, totalWall = 0;
+        for (size_t index = 0; index < audioPaths.size(); ++index) {
+            SpillBuffer response;
+            auto startTime = chrono::steady_clock::now();
+            bool succeeded = backend->transcribe(audioPaths[index], response, {});
+            double wall = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+            if (!succeeded) {
+                ++failed;
+                continue;
+            }
+            totalAudio += audioSeconds[index];
+            totalWall += wall;
+        }
+        allSucceeded = allSucceeded && failed == 0;
+        cout << left << setw(10) << name << right << setw(8) << audioPaths.size() << setw(8) << failed
+             << fixed << setprecision(1) << setw(12) << totalAudio << setw(12) << totalWall << setprecision(3);
+        if (totalAudio > 0 && totalWall > 0) {
+            cout << setw(8) << totalWall / totalAudio << setw(16) << setprecision(1) << totalAudio / totalWall;
+        } else {
+            cout << setw(8) << "-" << setw(16) << "-";
+        }
+        cout << endl;
+    }
+    return allSucceeded;
+}
+
+/**
+ * Function to print command-line usage
+ */
+void printUsage(const char *programName) {
+    cout << "Usage:" << endl
+         << "  " << programName << endl
+         << "      Transcribe and analyze an audio file interactively" << endl
+         << "  " << programName << " --batch <manifest> [--threads N]" << endl
+         << "      Process the audio files listed in a manifest concurrently, by priority class" << endl
+         << "  " << programName << " --bulk-latex <json dir> <tex dir> [--threads N]" << endl
+         << "      Regenerate LaTeX reports from stored categorized JSON files" << endl
+         << "  " << programName << " --build-pdf <tex dir> <pdf dir> [--jobs N]" << endl
+         << "      Compile changed LaTeX reports to PDF in parallel" << endl
+         << "  " << programName << " --search-index <json dir>" << endl
+         << "      Add stored categorized JSON files to the local search index" << endl
+         << "  " << programName << " --model-stats" << endl
+         << "      Show the categorization routes and observed latency per model" << endl
+         << "  " << programName << " --transcription-benchmark <audio file...>" << endl
+         << "      Compare the speed of API and local transcription on the given recordings" << endl
+         << "  " << programName << " --search <query...> [--limit N]" << endl
+         << "      Rank indexed transcripts and results against a query" << endl
+         << "  " << programName << " --archive <json dir> <archive file>" << endl
+         << "      Pack stored categorized JSON files into a compressed columnar archive" << endl
+         << "  " << programName << " --archive-stats <archive file>" << endl
+         << "      Total duration and AI cost per Type from an archive" << endl
+         << "  " << programName << " --archive-get <archive file> <record number>" << endl
+         << "      Print one archived record as JSON" << endl;
+}
+
+/**
+ * Main function - Entry point of the application
+ * 
+ * This function:
+ * 1. Prompts the user to select an audio file
+ * 2. Transcribes the audio using OpenAI's Whisper API
+ * 3. Analyzes the transcription using GPT-4o
+ * 4. Creates the Notion page with its basic metadata while the transcript is categorized,
+ *    then fills in the categorized data
+ * 5. Stores the categorized JSON and renders it as a LaTeX report
+ * 
+ * With --batch it runs the same pipeline for many recordings at once, with
+ * --bulk-latex it instead regenerates reports offline from stored JSON files,
+ * and with --search it queries the local index of past transcripts.
+ * 
+ * @return 0 on successful execution
+ */
+int main(int argc, char *argv[]) {
+    if (argc > 1) {
+        string command = argv[1];
+        if (command == "--bulk-latex" && (argc == 4 || (argc == 6 && string(argv[4]) == "--threads"))) {
+            size_t threadCount = argc == 6 ? strtoul(argv[5], nullptr, 10) : 0;
+            return bulkGenerateLatex(argv[2], argv[3], threadCount) ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+        if (command == "--batch" && (argc == 3 || (argc == 5 && string(argv[3]) == "--threads"))) {
+            size_t threadCount = argc == 5 ? strtoul(argv[4], nullptr, 10) : 0;
+            curl_global_init(CURL_GLOBAL_DEFAULT);
+            bool processed = processBatch(argv[2], threadCount);
+            curl_global_cleanup();
+            return processed ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+        if (command == "--build-pdf" && (argc == 4 || (argc == 6 && string(argv[4]) == "--jobs"))) {
+            size_t jobCount = argc == 6 ? strtoul(argv[5], nullptr, 10) : 0;
+            return buildPdfReports(argv[2], argv[3], jobCount) ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+        if (command == "--archive" && argc == 4) {
+            return buildArchive(argv[2], argv[3]) ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+        if (command == "--archive-stats" && argc == 3) {
+            return printArchiveStats(argv[2]) ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+        if (command == "--archive-get" && argc == 4) {
+            return printArchiveRecord(argv[2], strtoul(argv[3], nullptr, 10)) ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+        if (command == "--model-stats" && argc == 2) {
+            return printModelStats() ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+        if (command == "--transcription-benchmark" && argc > 2) {
+            curl_global_init(CURL_GLOBAL_DEFAULT);
+            bool benchmarked = benchmarkTranscription(vector<string>(argv + 2, argv + argc), OPENAI_API_KEY);
+            curl_global_cleanup();
+            return benchmarked ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+        if (command == "--search-index" && argc == 3) {
+            return indexCategorizedJson(argv[2]) ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+        if (command == "--search" && argc > 2) {
+            string query;
+            size_t limit = 10;
+            for (int i = 2; i < argc; ++i) {
+                if (string(argv[i]) == "--limit" && i + 1 < argc) {
+                    limit = strtoul(argv[++i], nullptr, 10);
+                } else {
+                    query += (query.empty() ? "" : " ") + string(argv[i]);
+                }
+            }
+            return searchTranscripts(query, limit) ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+        printUsage(argv[0]);
+        return command == "--help" ? EXIT_SUCCESS : EXIT_FAILURE;
     }
-    // Convert the JSON to LaTeX
-    string latex = convertToLatex(categorizedJson);
+
+    // All JSON documents of this job are allocated from one arena and freed together
+    JobArena jobArena;
+    JobArenaScope jobArenaScope(jobArena);
+
+    // libcurl's global state is set up once, before any request thread starts
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+
+    // Connect to the APIs and load the Notion schema while the user is choosing a file
+    vector<future<void>> warmUp = warmUpConnections(NOTION_DATABASE_ID, NOTION_API_KEY);
+
+    cout << "Select an audio file for transcription." << endl;
+    RecordingJob job;
+    job.audioPath = getFileFromDialog();
+    job.notionDatabaseId = NOTION_DATABASE_ID;
+    job.latexPath = "transcription_analysis.tex";
+    job.priority = JobPriority::Interactive;
     
-    // Save the LaTeX to a file
-    string latexFilePath = "transcription_analysis.tex";
-    if (saveLatexToFile(latex, latexFilePath)) {
-        cout << "LaTeX output saved to " << latexFilePath << endl;
-        
+    // Use the API keys from the config file
+    processRecording(job, OPENAI_API_KEY, NOTION_API_KEY);
+    SinkDispatcher &sinks = SinkDispatcher::instance();
+    if (sinks.drain() && sinks.hasSink("latex")) {
         // Compile the LaTeX file to PDF (if pdflatex is available)
-        string compileCommand = "pdflatex " + latexFilePath;
+        string compileCommand = "pdflatex " + job.latexPath;
         cout << "You can compile the LaTeX file to PDF using: " << compileCommand << endl;
-    } else {
-        cerr << "Failed to save LaTeX output." << endl;
-    }    
+        cout << "To compile all stored reports, run: " << argv[0] << " --bulk-latex categorized reports && "
+             << argv[0] << " --build-pdf reports pdf" << endl;
+    }
+    curl_global_cleanup();
     return 0;
 }
@@ -0,0 +1,159 @@
+#!/usr/bin/env node
+
+const { spawn } = require('child_process');
+const fs = require('fs');
+const http = require('http');
+const os = require('os');
+const path = require('path');
+
+// Help text
+if (process.argv.includes('--help') || process.argv.includes('-h')) {
+  console.log(`
+Load Test - Run many full vr_app pipeline jobs against the mock API server
+
+Usage:
+  ./load_test.js --audio FILE [options]
+
+Options:
+  --binary PATH         vr_app binary to run (default: ./vr_app)
+  --audio FILE          Audio file each job uploads (required)
+  --jobs N              Total number of jobs (default: 1000)
+  --concurrency N       Jobs running at the same time (default: 1000)
+  --server URL          Mock server base URL (default: http://127.0.0.1:8089)
+  --help, -h            Show this help message
+
+Each job runs in its own temporary working directory with OPENAI_BASE_URL and
+NOTION_BASE_URL pointing at the mock server (start it first with ./mock_api_server.js).
+A job succeeds when the data reaches Notion and the LaTeX report is written.
+
+Example:
+  ./mock_api_server.js --latency chat=lognormal:3000:0.5 --rate-429 all=0.01 &
+  ./load_test.js --audio sample.m4a --jobs 1000 --concurrency 1000
+  `);
+  process.exit(0);
+}
+
+// Parse command line arguments
+const options = {
+  binary: './vr_app',
+  audio: null,
+  jobs: 1000,
+  concurrency: 1000,
+  server: 'http://127.0.0.1:8089'
+};
+for (let i = 2; i < process.argv.length; i++) {
+  const arg = process.argv[i];
+  const value = process.argv[++i];
+  if (arg === '--binary') options.binary = path.resolve(value);
+  else if (arg === '--audio') options.audio = path.resolve(value);
+  else if (arg === '--jobs') options.jobs = parseInt(value, 10);
+  else if (arg === '--concurrency') options.concurrency = parseInt(value, 10);
+  else if (arg === '--server') options.server = value;
+  else {
+    console.error(`Error: unknown option "${arg}"`);
+    process.exit(1);
+  }
+}
+options.binary = path.resolve(options.binary);
+
+if (!options.audio || !fs.existsSync(options.audio)) {
+  console.error('Error: --audio must name an existing file.');
+  process.exit(1);
+}
+
+// Run one pipeline job and resolve with its outcome
+function runJob(index) {
+  return new Promise((resolve) => {
+    const workDir = fs.mkdtempSync(path.join(os.tmpdir(), 'vr_load_'));
+    const started = process.hrtime.bigint();
+    const child = spawn(options.binary, [], {
+      cwd: workDir,
+      env: { ...process.env, OPENAI_BASE_URL: options.server, NOTION_BASE_URL: options.server },
+      stdio: ['pipe', 'pipe', 'pipe']
+    });
+
+    let output = '';
+    child.stdout.on('data', (chunk) => { output += chunk; });
+    child.stderr.on('data', (chunk) => { output += chunk; });
+    child.stdin.end(`${options.audio}\n`);
+
+    const finish = (exitCode) => {
+      const latencyMs = Number(process.hrtime.bigint() - started) / 1e6;
+      const succeeded = exitCode === 0 &&
+        output.includes('Data successfully sent to Notion.') &&
+        output.includes('LaTeX output saved to');
+      fs.rmSync(workDir, { recursive: true, force: true });
+      resolve({ index, latencyMs, succeeded, output });
+    };
+    child.on('error', () => finish(-1));
+    child.on('close', finish);
+  });
+}
+
+function percentile(sorted, fraction) {
+  if (sorted.length === 0) return 0;
+  return sorted[Math.min(sorted.length - 1, Math.floor(fraction * sorted.length))];
+}
+
+function fetchServerStats() {
+  return new Promise((resolve) => {
+    http.get(`${options.server}/__stats`, (res) => {
+      let body = '';
+      res.on('data', (chunk) => { body += chunk; });
+      res.on('end', () => {
+        try {
+          resolve(JSON.parse(body));
+        } catch (error) {
+          resolve(null);
+        }
+      });
+    }).on('error', () => resolve(null));
+  });
+}
+
+async function main() {
+  console.log(`Running ${options.jobs} jobs with concurrency ${options.concurrency} against ${options.server}...`);
+  const results = [];
+  let nextJob = 0;
+  const started = Date.now();
+
+  // Each worker keeps one job in flight until all jobs are taken
+  async function worker() {
+    while (nextJob < options.jobs) {
+      results.push(await runJob(nextJob++));
+    }
+  }
+  const workers = [];
+  for (let i = 0; i < Math.min(options.concurrency, options.jobs); i++) {
+    workers.push(worker());
+  }
+  await Promise.all(workers);
+  const elapsedSeconds = (Date.now() - started) / 1000;
+
+  const failures = results.filter((result) => !result.succeeded);
+  const latencies = results.map((result) => result.latencyMs).sort((a, b) => a - b);
+
+  console.log(`Completed ${results.length - failures.length} of ${results.length} jobs in ${elapsedSeconds.toFixed(2)}s`);
+  console.log(`Throughput: ${(results.length / elapsedSeconds).toFixed(2)} jobs/s`);
+  console.log('Job latency (ms): ' +
+    `p50=${percentile(latencies, 0.5).toFixed(0)} ` +
+    `p90=${percentile(latencies, 0.9).toFixed(0)} ` +
+    `p95=${percentile(latencies, 0.95).toFixed(0)} ` +
+    `p99=${percentile(latencies, 0.99).toFixed(0)} ` +
+    `max=${latencies[latencies.length - 1].toFixed(0)}`);
+
+  if (failures.length > 0) {
+    console.log(`\nFirst failed job (#${failures[0].index}) output:\n${failures[0].output}`);
+  }
+
+  const serverStats = await fetchServerStats();
+  if (serverStats) {
+    console.log('\nMock server statistics:');
+    for (const [endpoint, entry] of Object.entries(serverStats.endpoints)) {
+      console.log(`  ${endpoint}: ${entry.requests} requests, ${entry.rateLimited} rate limited`);
+    }
+  }
+  process.exit(failures.length > 0 ? 1 : 0);
+}
+
+main();
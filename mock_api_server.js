@@ -0,0 +1,401 @@
+#!/usr/bin/env node
+
+const http = require('http');
+
+// Help text
+if (process.argv.includes('--help') || process.argv.includes('-h')) {
+  console.log(`
+Mock API Server - Local stand-in for the OpenAI and Notion endpoints used by vr_app
+
+Usage:
+  ./mock_api_server.js [options]
+
+Options:
+  --port PORT                 Port to listen on (default: 8089)
+  --latency ENDPOINT=DIST     Response latency for an endpoint (repeatable)
+  --rate-429 ENDPOINT=P       Fraction of requests answered with HTTP 429 (repeatable)
+  --transcript-words N        Number of words in each transcript (default: 300)
+  --chat-padding BYTES        Extra bytes added to each chat completion's Summary (default: 0)
+  --malformed-chat P          Fraction of chat replies with malformed JSON (fences, trailing
+                              commas, wrong types or truncation) (default: 0)
+  --missing-properties        Report a database without the Voice Notes properties, forcing a PATCH
+  --seed N                    Seed for latencies, 429 injection and content (default: 1)
+  --help, -h                  Show this help message
+
+Endpoints (ENDPOINT may also be "all"):
+  transcription    POST  /v1/audio/transcriptions
+  chat             POST  /v1/chat/completions
+  database_get     GET   /v1/databases/:id
+  database_patch   PATCH /v1/databases/:id
+  pages            POST  /v1/pages
+  page_patch       PATCH /v1/pages/:id
+
+Latency distributions (milliseconds):
+  fixed:MS  uniform:MIN:MAX  normal:MEAN:SD  lognormal:MEDIAN:SIGMA  exp:MEAN
+
+Statistics are served at GET /__stats and printed on exit.
+
+Examples:
+  ./mock_api_server.js --latency transcription=lognormal:1500:0.4 --latency chat=lognormal:4000:0.6
+  ./mock_api_server.js --latency all=fixed:50 --rate-429 chat=0.05
+
+Point vr_app at the server with:
+  OPENAI_BASE_URL=http://127.0.0.1:8089 NOTION_BASE_URL=http://127.0.0.1:8089 ./vr_app
+  `);
+  process.exit(0);
+}
+
+const ENDPOINTS = ['transcription', 'chat', 'database_get', 'database_patch', 'pages', 'page_patch'];
+
+// Default options
+const options = {
+  port: 8089,
+  latency: {},
+  rate429: {},
+  transcriptWords: 300,
+  chatPadding: 0,
+  malformedChat: 0,
+  missingProperties: false,
+  seed: 1
+};
+for (const endpoint of ENDPOINTS) {
+  options.latency[endpoint] = 'fixed:0';
+  options.rate429[endpoint] = 0;
+}
+
+// Parse "ENDPOINT=VALUE" arguments into a per-endpoint table
+function setPerEndpoint(table, spec, parse) {
+  const separator = spec.indexOf('=');
+  if (separator < 0) {
+    console.error(`Error: expected ENDPOINT=VALUE, got "${spec}"`);
+    process.exit(1);
+  }
+  const endpoint = spec.slice(0, separator);
+  const value = parse(spec.slice(separator + 1));
+  if (endpoint === 'all') {
+    for (const name of ENDPOINTS) {
+      table[name] = value;
+    }
+  } else if (ENDPOINTS.includes(endpoint)) {
+    table[endpoint] = value;
+  } else {
+    console.error(`Error: unknown endpoint "${endpoint}"`);
+    process.exit(1);
+  }
+}
+
+// Parse command line arguments
+for (let i = 2; i < process.argv.length; i++) {
+  const arg = process.argv[i];
+  const next = () => process.argv[++i];
+  if (arg === '--port') {
+    options.port = parseInt(next(), 10);
+  } else if (arg === '--latency') {
+    setPerEndpoint(options.latency, next(), (value) => value);
+  } else if (arg === '--rate-429') {
+    setPerEndpoint(options.rate429, next(), parseFloat);
+  } else if (arg === '--transcript-words') {
+    options.transcriptWords = parseInt(next(), 10);
+  } else if (arg === '--chat-padding') {
+    options.chatPadding = parseInt(next(), 10);
+  } else if (arg === '--malformed-chat') {
+    options.malformedChat = parseFloat(next());
+  } else if (arg === '--missing-properties') {
+    options.missingProperties = true;
+  } else if (arg === '--seed') {
+    options.seed = parseInt(next(), 10);
+  } else {
+    console.error(`Error: unknown option "${arg}"`);
+    process.exit(1);
+  }
+}
+
+// Seeded PRNG (mulberry32) so that runs with the same seed see the same latencies and errors
+let rngState = options.seed >>> 0;
+function random() {
+  rngState = (rngState + 0x6D2B79F5) >>> 0;
+  let t = rngState;
+  t = Math.imul(t ^ (t >>> 15), t | 1);
+  t ^= t + Math.imul(t ^ (t >>> 7), t | 61);
+  return ((t ^ (t >>> 14)) >>> 0) / 4294967296;
+}
+
+function randomNormal() {
+  // Box-Muller transform
+  const u = 1 - random();
+  const v = random();
+  return Math.sqrt(-2 * Math.log(u)) * Math.cos(2 * Math.PI * v);
+}
+
+// Compile a latency specification into a sampling function
+function compileLatency(spec) {
+  const [kind, ...rawParams] = spec.split(':');
+  const params = rawParams.map(parseFloat);
+  const invalid = params.some(Number.isNaN);
+  const samplers = {
+    fixed: () => params[0],
+    uniform: () => params[0] + random() * (params[1] - params[0]),
+    normal: () => params[0] + randomNormal() * params[1],
+    lognormal: () => params[0] * Math.exp(randomNormal() * params[1]),
+    exp: () => -params[0] * Math.log(1 - random())
+  };
+  const expectedParams = { fixed: 1, uniform: 2, normal: 2, lognormal: 2, exp: 1 };
+  if (!samplers[kind] || invalid || params.length !== expectedParams[kind]) {
+    console.error(`Error: invalid latency distribution "${spec}"`);
+    process.exit(1);
+  }
+  return () => Math.max(0, samplers[kind]());
+}
+
+const latencySamplers = {};
+for (const endpoint of ENDPOINTS) {
+  latencySamplers[endpoint] = compileLatency(options.latency[endpoint]);
+}
+
+// Word list used to generate transcripts of the requested size
+const WORDS = ('the meeting covered quarterly planning budget hiring roadmap customer feedback release ' +
+  'schedule design review follow up action items we should consider next steps before friday').split(' ');
+
+function makeTranscript() {
+  const words = [];
+  for (let i = 0; i < options.transcriptWords; i++) {
+    words.push(WORDS[Math.floor(random() * WORDS.length)]);
+  }
+  return words.join(' ') + '.';
+}
+
+// verbose_json transcription with word and/or segment timings, 0.4 s per word
+function makeVerboseTranscript(granularities) {
+  const text = makeTranscript();
+  const words = text.slice(0, -1).split(' ');
+  const response = { task: 'transcribe', language: 'english', duration: words.length * 0.4, text };
+  if (granularities.includes('word')) {
+    response.words = words.map((word, i) => ({ word, start: i * 0.4, end: i * 0.4 + 0.32 }));
+  }
+  if (granularities.includes('segment')) {
+    response.segments = [];
+    for (let i = 0; i < words.length; i += 12) {
+      const end = Math.min(words.length, i + 12);
+      response.segments.push({ id: response.segments.length, start: i * 0.4, end: end * 0.4,
+                               text: ' ' + words.slice(i, end).join(' ') });
+    }
+  }
+  return response;
+}
+
+// Form fields follow the uploaded file, so the tail of the body holds the options
+function transcriptionOptions(bodyTail) {
+  const tail = bodyTail.toString('latin1');
+  if (!tail.includes('verbose_json')) return null;
+  const granularities = [];
+  const pattern = /name="timestamp_granularities\[\]"\r\n\r\n(\w+)/g;
+  for (let match; (match = pattern.exec(tail)) !== null;) {
+    granularities.push(match[1]);
+  }
+  return granularities.length ? granularities : ['segment'];
+}
+
+// Categorized result in the shape the chat prompt asks for
+function makeCategorizedContent() {
+  return JSON.stringify({
+    AI_Title: 'Mock Meeting Notes',
+    Summary: 'A mock summary of the recording.' + ' '.repeat(options.chatPadding),
+    'Main Points': ['First point', 'Second point', 'Third point'],
+    'Action Items': ['Send the follow-up email', 'Book the review'],
+    'Follow-up Questions': ['What is the timeline?'],
+    Stories: [],
+    References: ['Quarterly plan'],
+    Arguments: ['Hiring should wait until the release'],
+    Sentiment: 'Positive',
+    Type: 'Meeting Notes',
+    Duration: '00:02:00',
+    'Duration (Seconds)': 120,
+    'AI Cost': 0.01,
+    Icon: '🤖'
+  });
+}
+
+// Categorized result with one of the defects models produce without structured output
+function makeMalformedContent() {
+  const content = makeCategorizedContent();
+  switch (Math.floor(random() * 4)) {
+    case 0:
+      return 'Here is the analysis:\n```json\n' + content + '\n```';
+    case 1:
+      return content.replace(/\]/g, ',]').replace(/\}$/, ',}');
+    case 2: {
+      const data = JSON.parse(content);
+      data.Summary = [data.Summary];
+      data['Main Points'] = data['Main Points'].join('; ');
+      data['AI Cost'] = '$0.01';
+      data.Confidence = 'high';
+      return JSON.stringify(data);
+    }
+    default:
+      return content.slice(0, Math.floor(content.length * 0.6));
+  }
+}
+
+// Database schema as reported by GET /v1/databases/:id
+const VOICE_NOTES_PROPERTIES = {
+  'Main Points': 'rich_text',
+  'Action Items': 'rich_text',
+  'Follow-up Questions': 'rich_text',
+  Stories: 'rich_text',
+  References: 'rich_text',
+  Arguments: 'rich_text',
+  Sentiment: 'rich_text',
+  Type: 'select',
+  Duration: 'rich_text',
+  'AI Cost': 'number',
+  'Duration (Seconds)': 'number',
+  Date: 'date',
+  Icon: 'rich_text'
+};
+
+function makeDatabase(id) {
+  const properties = { Name: { id: 'title', name: 'Name', type: 'title', title: {} } };
+  if (!options.missingProperties) {
+    for (const [name, type] of Object.entries(VOICE_NOTES_PROPERTIES)) {
+      properties[name] = { id: name.toLowerCase().replace(/\W/g, ''), name, type, [type]: {} };
+    }
+  }
+  return { object: 'database', id, title: [{ type: 'text', plain_text: 'Voice Notes' }], properties };
+}
+
+let pageCounter = 0;
+
+function makePageId() {
+  pageCounter++;
+  const hex = pageCounter.toString(16).padStart(12, '0');
+  return `00000000-0000-4000-8000-${hex}`;
+}
+
+// Route a request to its endpoint name, or null if it is not one we serve
+function routeRequest(method, url) {
+  if (method === 'POST' && url === '/v1/audio/transcriptions') return 'transcription';
+  if (method === 'POST' && url === '/v1/chat/completions') return 'chat';
+  if (method === 'GET' && url.startsWith('/v1/databases/')) return 'database_get';
+  if (method === 'PATCH' && url.startsWith('/v1/databases/')) return 'database_patch';
+  if (method === 'POST' && url === '/v1/pages') return 'pages';
+  if (method === 'PATCH' && url.startsWith('/v1/pages/')) return 'page_patch';
+  return null;
+}
+
+function buildResponse(endpoint, url, bodyTail) {
+  switch (endpoint) {
+    case 'transcription': {
+      const granularities = transcriptionOptions(bodyTail);
+      return granularities ? makeVerboseTranscript(granularities) : { text: makeTranscript() };
+    }
+    case 'chat':
+      return {
+        id: 'chatcmpl-mock',
+        object: 'chat.completion',
+        model: 'gpt-4o',
+        choices: [{ index: 0, message: { role: 'assistant', content: random() < options.malformedChat ? makeMalformedContent() : makeCategorizedContent() }, finish_reason: 'stop' }],
+        usage: { prompt_tokens: 0, completion_tokens: 0, total_tokens: 0 }
+      };
+    case 'database_get':
+    case 'database_patch':
+      return makeDatabase(url.slice('/v1/databases/'.length));
+    case 'pages':
+      return { object: 'page', id: makePageId() };
+    case 'page_patch':
+      return { object: 'page', id: url.slice('/v1/pages/'.length) };
+  }
+  return null;
+}
+
+function rateLimitBody(endpoint) {
+  if (endpoint === 'transcription' || endpoint === 'chat') {
+    return { error: { message: 'Rate limit reached (mock)', type: 'requests', code: 'rate_limit_exceeded' } };
+  }
+  return { object: 'error', status: 429, code: 'rate_limited', message: 'Rate limited (mock)' };
+}
+
+// Request statistics
+const stats = { started: Date.now(), endpoints: {} };
+for (const endpoint of ENDPOINTS) {
+  stats.endpoints[endpoint] = { requests: 0, rateLimited: 0, requestBytes: 0, responseBytes: 0, latenciesMs: [] };
+}
+
+function percentile(sorted, fraction) {
+  if (sorted.length === 0) return 0;
+  return sorted[Math.min(sorted.length - 1, Math.floor(fraction * sorted.length))];
+}
+
+function summarizeStats() {
+  const summary = { uptimeSeconds: (Date.now() - stats.started) / 1000, endpoints: {} };
+  for (const [endpoint, entry] of Object.entries(stats.endpoints)) {
+    const sorted = [...entry.latenciesMs].sort((a, b) => a - b);
+    summary.endpoints[endpoint] = {
+      requests: entry.requests,
+      rateLimited: entry.rateLimited,
+      requestBytes: entry.requestBytes,
+      responseBytes: entry.responseBytes,
+      latencyMs: { p50: percentile(sorted, 0.5), p95: percentile(sorted, 0.95), p99: percentile(sorted, 0.99) }
+    };
+  }
+  return summary;
+}
+
+const server = http.createServer((req, res) => {
+  if (req.method === 'GET' && req.url === '/__stats') {
+    res.writeHead(200, { 'Content-Type': 'application/json' });
+    res.end(JSON.stringify(summarizeStats(), null, 2));
+    return;
+  }
+
+  const endpoint = routeRequest(req.method, req.url);
+  let requestBytes = 0;
+  let bodyTail = Buffer.alloc(0);
+  req.on('data', (chunk) => {
+    requestBytes += chunk.length;
+    bodyTail = Buffer.concat([bodyTail, chunk]).subarray(-4096);
+  });
+  req.on('end', () => {
+    if (!endpoint) {
+      res.writeHead(404, { 'Content-Type': 'application/json' });
+      res.end(JSON.stringify({ object: 'error', status: 404, message: `No mock for ${req.method} ${req.url}` }));
+      return;
+    }
+
+    const entry = stats.endpoints[endpoint];
+    entry.requests++;
+    entry.requestBytes += requestBytes;
+
+    // Decide the outcome up front so the random sequence does not depend on timing
+    const rateLimited = random() < options.rate429[endpoint];
+    const latencyMs = latencySamplers[endpoint]();
+    const status = rateLimited ? 429 : 200;
+    const body = JSON.stringify(rateLimited ? rateLimitBody(endpoint) : buildResponse(endpoint, req.url, bodyTail));
+
+    setTimeout(() => {
+      const headers = { 'Content-Type': 'application/json', 'Content-Length': Buffer.byteLength(body) };
+      if (rateLimited) {
+        headers['Retry-After'] = '1';
+        entry.rateLimited++;
+      }
+      res.writeHead(status, headers);
+      res.end(body);
+      entry.responseBytes += Buffer.byteLength(body);
+      entry.latenciesMs.push(Math.round(latencyMs));
+    }, latencyMs);
+  });
+});
+
+// Many concurrent jobs open connections at once
+server.maxConnections = 100000;
+server.keepAliveTimeout = 60000;
+
+server.listen(options.port, '127.0.0.1', () => {
+  console.log(`Mock API server listening on http://127.0.0.1:${options.port}`);
+});
+
+function shutdown() {
+  console.log(JSON.stringify(summarizeStats(), null, 2));
+  process.exit(0);
+}
+process.on('SIGINT', shutdown);
+process.on('SIGTERM', shutdown);